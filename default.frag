@@ -5,14 +5,15 @@ out vec4 FragColor; // koncowy kolor piksela
 in vec2 TexCoords; // interpolowane wspolrzedne tekstury z vertex shadera
 in vec3 Normal;    // interpolowana normalna z vertex shadera
 in vec3 FragPos;   // interpolowana pozycja fragmentu z vertex shadera
+flat in float TexLayer; // warstwa tablicy tekstur
 
 uniform vec4 uColor;          // kolor bazowy jesli brak tekstury
-uniform sampler2D uTexture;   // obiekt tekstury
+uniform sampler2DArray uTextureArray; // tablica tekstur, warstwa w TexLayer
 uniform int useTexture;       // flaga czy uzyc tekstury (1 tak 0 nie)
 uniform int disableLighting;  // flaga czy wylaczyc oswietlenie (1 tak 0 nie)
 
-uniform vec3 lightPos = vec3(0.0, 50.0, 50.0); // pozycja zrodla swiatla
-uniform vec3 viewPos; // pozycja kamery widza
+uniform vec3 lightPos = vec3(0.0, 50.0, 50.0); // pozycja zrodla swiatla (wzgledem kamery)
+uniform vec3 viewPos; // pozycja kamery widza (przy renderowaniu wzgledem kamery zero)
 uniform vec3 lightColor = vec3(1.0, 1.0, 1.0); // kolor swiatla
 
 void main() {
@@ -37,7 +38,7 @@ void main() {
     }
 
     if (useTexture == 1) { // jesli uzywamy tekstury
-        vec4 texColor = texture(uTexture, TexCoords); // pobierz kolor z tekstury
+        vec4 texColor = texture(uTextureArray, vec3(TexCoords, TexLayer)); // pobierz kolor z tekstury
         FragColor = vec4(lightingResult * texColor.rgb, texColor.a); // koncowy kolor z tekstura i oswietleniem
     } else { // jesli uzywamy koloru
         FragColor = vec4(lightingResult * uColor.rgb, uColor.a); // koncowy kolor z uColor i oswietleniem
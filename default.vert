@@ -1,20 +1,49 @@
 // default.vert
 #version 330 core
 layout(location = 0) in vec3 aPos;         // pozycja wierzcholka
-layout(location = 1) in vec3 aNormal;      // normalna wierzcholka
+layout(location = 1) in vec3 aNormal;      // normalna wierzcholka (albo 2 skladowe oktaedryczne)
 layout(location = 2) in vec2 aTexCoords;   // wspolrzedne tekstury
+layout(location = 3) in int aInstance;     // indeks klocka w uInstanceData (tylko przy uInstanced)
 
 uniform mat4 uProjection; // macierz rzutowania
 uniform mat4 uView;       // macierz widoku kamery
 uniform mat4 uModel;      // macierz modelu obiektu
+uniform int uOctNormals;  // 1 = normalna zakodowana oktaedrycznie w aNormal.xy (spakowane siatki)
+uniform int uInstanced;   // 1 = macierz modelu z uInstanceData zamiast uModel
+uniform samplerBuffer uInstanceData; // 4 x vec4 na klocek: kolumny obrotu ze skala, przesuniecie + warstwa tekstury
+uniform vec3 uInstanceOrigin;        // kotwica zbioru klockow wzgledem kamery
+uniform float uTextureLayer;         // warstwa tablicy tekstur gdy nie uInstanced
 
 out vec2 TexCoords; // przekazane wspolrzedne tekstury do fragment shadera
 out vec3 Normal;    // przekazana normalna wierzcholka do fragment shadera
-out vec3 FragPos;   // przekazana pozycja fragmentu do fragment shadera
+out vec3 FragPos;   // przekazana pozycja fragmentu do fragment shadera (wzgledem kamery)
+flat out float TexLayer; // warstwa tablicy tekstur
+
+// dekodowanie normalnej z kwadratu [-1, 1]^2 na sfere jednostkowa
+vec3 octDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    if (n.z < 0.0) {
+        vec2 signs = vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+        n.xy = (1.0 - abs(n.yx)) * signs;
+    }
+    return normalize(n);
+}
 
 void main() {
     TexCoords = aTexCoords; // przypisz wspolrzedne tekstury
-    FragPos = vec3(uModel * vec4(aPos, 1.0)); // oblicz pozycje fragmentu w przestrzeni swiata
-    Normal = mat3(transpose(inverse(uModel))) * aNormal; // transformuj normalna modelu
-    gl_Position = uProjection * uView * uModel * vec4(aPos, 1.0); // finalna pozycja wierzcholka na ekranie
+    mat4 model = uModel;
+    TexLayer = uTextureLayer;
+    if (uInstanced == 1) { // dane klocka z bufora tekstury
+        int base = aInstance * 4;
+        vec4 translation = texelFetch(uInstanceData, base + 3);
+        model = mat4(vec4(texelFetch(uInstanceData, base).xyz, 0.0),
+                     vec4(texelFetch(uInstanceData, base + 1).xyz, 0.0),
+                     vec4(texelFetch(uInstanceData, base + 2).xyz, 0.0),
+                     vec4(translation.xyz + uInstanceOrigin, 1.0));
+        TexLayer = translation.w;
+    }
+    FragPos = vec3(model * vec4(aPos, 1.0)); // oblicz pozycje fragmentu w przestrzeni swiata przesunietej do kamery
+    vec3 normal = uOctNormals == 1 ? octDecode(aNormal.xy) : aNormal; // normalna w ukladzie modelu
+    Normal = mat3(transpose(inverse(model))) * normal; // transformuj normalna modelu
+    gl_Position = uProjection * uView * model * vec4(aPos, 1.0); // finalna pozycja wierzcholka na ekranie
 }
\ No newline at end of file
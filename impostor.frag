@@ -0,0 +1,34 @@
+// impostor.frag
+#version 330 core
+out vec4 FragColor; // koncowy kolor piksela
+
+flat in vec3 CenterView; // srodek kuli w przestrzeni widoku
+
+uniform mat4 uProjection;    // macierz rzutowania
+uniform mat4 uInvProjection; // odwrotnosc macierzy rzutowania
+uniform vec4 uViewport;      // x, y, szerokosc, wysokosc obszaru rysowania w pikselach
+uniform float uRadius;       // promien kuli
+uniform vec4 uColor;         // kolor sladu (bez oswietlenia, jak dotychczas)
+
+void main() {
+    // promien z kamery (poczatek ukladu widoku) przez srodek piksela
+    vec2 ndc = (gl_FragCoord.xy - uViewport.xy) / uViewport.zw * 2.0 - 1.0;
+    vec4 nearPoint = uInvProjection * vec4(ndc, -1.0, 1.0);
+    vec3 rayDir = normalize(nearPoint.xyz / nearPoint.w);
+
+    // przeciecie promienia z kula: |t * rayDir - CenterView|^2 = r^2
+    float b = dot(rayDir, CenterView);
+    float c = dot(CenterView, CenterView) - uRadius * uRadius;
+    float disc = b * b - c;
+    if (disc < 0.0) discard; // piksel poza obrysem kuli
+
+    float t = b - sqrt(disc);
+    if (t <= 0.0) discard; // kamera wewnatrz kuli albo kula za kamera
+    vec3 hit = t * rayDir;
+
+    // glebokosc prawdziwej powierzchni kuli, zeby slad poprawnie przecinal sie z geometria
+    vec4 clip = uProjection * vec4(hit, 1.0);
+    gl_FragDepth = (clip.z / clip.w) * 0.5 + 0.5;
+
+    FragColor = uColor;
+}
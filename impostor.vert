@@ -0,0 +1,22 @@
+// impostor.vert
+#version 330 core
+layout(location = 0) in vec3 aCenter; // srodek kuli sladu (wzgledem uOrigin)
+
+uniform mat4 uProjection; // macierz rzutowania
+uniform mat4 uView;       // macierz widoku kamery
+uniform vec4 uViewport;   // x, y, szerokosc, wysokosc obszaru rysowania w pikselach
+uniform float uRadius;    // promien kuli
+uniform vec3 uOrigin;     // poczatek ukladu sladu wzgledem kamery
+
+flat out vec3 CenterView; // srodek kuli w przestrzeni widoku
+
+void main() {
+    vec4 center = uView * vec4(aCenter + uOrigin, 1.0);
+    CenterView = center.xyz;
+    gl_Position = uProjection * center;
+
+    // rozmiar punktu z zapasem: liczymy dla najblizszego punktu kuli,
+    // zeby kwadrat na pewno pokryl caly jej obrys
+    float dist = max(-center.z - uRadius, 0.05);
+    gl_PointSize = uViewport.w * uProjection[1][1] * uRadius / dist;
+}
@@ -9,7 +9,24 @@
 #include <fstream>
 #include <iostream>
 #include <algorithm> // Dla std::max, std::min
-#include <map>       // Dla std::map do przechowywania tekstur
+#include <string>
+#include <stdexcept>
+#include <sstream>
+#include <type_traits>
+#include <cstdlib>   // Dla std::atof
+#include <cstdint>
+#include <cstring>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <map>
+#include <condition_variable>
+#include <memory>
+#include <cstdio>
+#include <functional>
+#include <deque>
+#include <chrono>
+#include <iomanip>
 
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
@@ -21,6 +38,29 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+// SSE do testu kuli z 4 plaszczyznami ostroslupa naraz
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define RZUT_HAS_SSE 1
+#endif
+
+// Mapowanie plikow do pamieci (MappedFile)
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <direct.h>
+#include <sys/stat.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
 // Do ładowania tekstur
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -30,46 +70,225 @@
 #define offsetof(st, m) ((size_t)&(((st*)0)->m))
 #endif
 
-char* get_file_contents(const char* filename)
-{
-    std::ifstream in(filename, std::ios::binary);
-    if (in)
-    {
-        in.seekg(0, std::ios::end);
-        std::streamsize size = in.tellg();
-        in.seekg(0, std::ios::beg);
+// GL 4.4 / ARB_buffer_storage - glad jest wygenerowany tylko dla 3.3,
+// wiec funkcje i stale dociagamy sami przez glfwGetProcAddress
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFNRZUTBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags);
+PFNRZUTBUFFERSTORAGEPROC rzutBufferStorage = nullptr;
 
-        char* buffer = new char[size + 1];
-        if (!in.read(buffer, size))
-        {
-            delete[] buffer;
-            throw std::runtime_error("Error reading file");
-        }
-        buffer[size] = '\0';
-        in.close();
-        return buffer;
+// GL 4.1 / ARB_get_program_binary - tak samo dociagane recznie
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+typedef void (APIENTRYP PFNRZUTGETPROGRAMBINARYPROC)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+typedef void (APIENTRYP PFNRZUTPROGRAMBINARYPROC)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+typedef void (APIENTRYP PFNRZUTPROGRAMPARAMETERIPROC)(GLuint program, GLenum pname, GLint value);
+PFNRZUTGETPROGRAMBINARYPROC rzutGetProgramBinary = nullptr;
+PFNRZUTPROGRAMBINARYPROC rzutProgramBinary = nullptr;
+PFNRZUTPROGRAMPARAMETERIPROC rzutProgramParameteri = nullptr;
+
+bool glVersionAtLeast(int wantMajor, int wantMinor) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    return major > wantMajor || (major == wantMajor && minor >= wantMinor);
+}
+
+bool hasGLExtension(const char* name) {
+    GLint extCount = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &extCount);
+    for (GLint i = 0; i < extCount; i++) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && std::strcmp(ext, name) == 0) return true;
+    }
+    return false;
+}
+
+// Plik zmapowany tylko do odczytu; widok wazny do zamkniecia / zniszczenia obiektu.
+// copyOnWrite = strony mozna zmieniac w pamieci (prywatna kopia strony), plik zostaje bez zmian
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const char* path, bool copyOnWrite = false) {
+        close();
+#ifdef _WIN32
+        file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) { close(); return false; }
+        mapping = CreateFileMappingA(file, nullptr, copyOnWrite ? PAGE_WRITECOPY : PAGE_READONLY, 0, 0, nullptr);
+        if (!mapping) { close(); return false; }
+        view = (unsigned char*)MapViewOfFile(mapping, copyOnWrite ? FILE_MAP_COPY : FILE_MAP_READ, 0, 0, 0);
+        if (!view) { close(); return false; }
+        length = (size_t)fileSize.QuadPart;
+#else
+        int fd = ::open(path, O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size == 0) { ::close(fd); return false; }
+        void* p = mmap(nullptr, (size_t)st.st_size, copyOnWrite ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd); // mapowanie trzyma plik samo
+        if (p == MAP_FAILED) return false;
+        view = (unsigned char*)p;
+        length = (size_t)st.st_size;
+#endif
+        return true;
+    }
+
+    void close() {
+#ifdef _WIN32
+        if (view) UnmapViewOfFile(view);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = nullptr;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (view) munmap((void*)view, length);
+#endif
+        view = nullptr;
+        length = 0;
     }
-    throw errno;
+
+    const unsigned char* data() const { return view; }
+    unsigned char* mutableData() { return view; } // tylko przy copyOnWrite
+    size_t size() const { return length; }
+
+private:
+    unsigned char* view = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+};
+
+// FNV-1a 64-bit
+uint64_t fnv1a(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
 }
 
+void makeDirectory(const char* path) {
+#ifdef _WIN32
+    _mkdir(path);
+#else
+    mkdir(path, 0755);
+#endif
+}
+
+time_t fileModificationTime(const char* path) {
+#ifdef _WIN32
+    struct _stat st;
+    return _stat(path, &st) == 0 ? st.st_mtime : 0;
+#else
+    struct stat st;
+    return stat(path, &st) == 0 ? st.st_mtime : 0;
+#endif
+}
+
+// Blad wczytywania zasobu (brak pliku, pusty plik); path - plik, ktorego dotyczy
+class AssetError : public std::runtime_error {
+public:
+    AssetError(const std::string& path, const std::string& reason)
+        : std::runtime_error(reason + ": " + path), path(path) {}
+    std::string path;
+};
+
+// Zasob zmapowany tylko do odczytu na czas zycia obiektu - bez kopii i bez
+// recznego zwalniania. Dane nie koncza sie zerem, dlugosc jest w size()
+class AssetView {
+public:
+    explicit AssetView(const char* path) {
+        if (!file.open(path)) throw AssetError(path, "Nie mozna otworzyc pliku");
+    }
+    const unsigned char* data() const { return file.data(); }
+    const char* chars() const { return (const char*)file.data(); }
+    size_t size() const { return file.size(); }
+
+private:
+    MappedFile file;
+};
+
 // Struktury
-struct Vec3 {
-    float x, y, z;
-    Vec3 operator+(const Vec3& b) const { return { x + b.x, y + b.y, z + b.z }; }
-    Vec3 operator*(float s) const { return { x * s, y * s, z * s }; }
-    Vec3 operator-(const Vec3& b) const { return { x - b.x, y - b.y, z - b.z }; }
-    float length() const { return std::sqrt(x * x + y * y + z * z); }
-    Vec3 normalize() const {
-        float l = length();
-        return l > 0 ? Vec3{ x / l, y / l, z / l } : Vec3{ 0,0,0 };
+template <typename T>
+struct Vec3T {
+    T x, y, z;
+    Vec3T operator+(const Vec3T& b) const { return { x + b.x, y + b.y, z + b.z }; }
+    Vec3T operator*(T s) const { return { x * s, y * s, z * s }; }
+    Vec3T operator-(const Vec3T& b) const { return { x - b.x, y - b.y, z - b.z }; }
+    T length() const { return std::sqrt(x * x + y * y + z * z); }
+    Vec3T normalize() const {
+        T l = length();
+        return l > 0 ? Vec3T{ x / l, y / l, z / l } : Vec3T{ 0,0,0 };
+    }
+    T dot(const Vec3T& b) const { return x * b.x + y * b.y + z * b.z; }
+    Vec3T cross(const Vec3T& b) const { return { y * b.z - z * b.y, z * b.x - x * b.z, x * b.y - y * b.x }; }
+};
+typedef Vec3T<float> Vec3;
+
+template <typename To, typename From>
+Vec3T<To> vec3Cast(const Vec3T<From>& v) { return { (To)v.x, (To)v.y, (To)v.z }; }
+
+// Typ skalarny pozycji i predkosci pocisku, wybierany przy kompilacji.
+// -DRZUT_DOUBLE_PRECISION dla dalekich strzalow; domyslnie float jak dotad.
+#ifdef RZUT_DOUBLE_PRECISION
+typedef double SimScalar;
+#else
+typedef float SimScalar;
+#endif
+
+// Macierz 3x3 (wierszami) dla orientacji klockow
+struct Mat3 {
+    Vec3 r[3];
+    Vec3 operator*(const Vec3& v) const { return { r[0].dot(v), r[1].dot(v), r[2].dot(v) }; }
+    Mat3 operator*(const Mat3& b) const {
+        Mat3 bt = b.transposed();
+        return { { { r[0].dot(bt.r[0]), r[0].dot(bt.r[1]), r[0].dot(bt.r[2]) },
+                   { r[1].dot(bt.r[0]), r[1].dot(bt.r[1]), r[1].dot(bt.r[2]) },
+                   { r[2].dot(bt.r[0]), r[2].dot(bt.r[1]), r[2].dot(bt.r[2]) } } };
     }
-    float dot(const Vec3& b) const { return x * b.x + y * b.y + z * b.z; }
+    // Dla macierzy obrotu transpozycja jest odwrotnoscia
+    Mat3 transposed() const {
+        return { { { r[0].x, r[1].x, r[2].x },
+                   { r[0].y, r[1].y, r[2].y },
+                   { r[0].z, r[1].z, r[2].z } } };
+    }
+    static Mat3 identity() { return { { { 1,0,0 }, { 0,1,0 }, { 0,0,1 } } }; }
 };
 
-struct Projectile {
-    Vec3 pos, vel;
-    std::vector<Vec3> trail;
+template <typename T>
+struct ProjectileT {
+    Vec3T<T> pos, vel;
+    Vec3T<T> posCompensation = { 0,0,0 }; // utracone mlodsze bity pozycji (sumowanie Kahana)
+    std::deque<Vec3> trail;
+    uint64_t trailPushed = 0; // ile punktow dodano do sladu od poczatku programu (nie zerowane)
+    unsigned trailEpoch = 0;  // zwiekszany przy kazdym czyszczeniu sladu
+    Vec3 spin = { 0,0,0 }; // predkosc katowa [rad/s]
+    bool useSpin = false;  // false = tansza sciezka bez efektu Magnusa
+    bool sleeping = false; // uspiony pocisk nie jest juz liczony w update()
+    float restTimer = 0.0f; // jak dlugo pocisk spelnia warunek spoczynku [s]
 };
+typedef ProjectileT<SimScalar> Projectile;
+
+// Uchwyt tekstury z menedzera tekstur (indeks slotu)
+typedef int32_t TextureHandle;
+const TextureHandle NO_TEXTURE = -1;
 
 // Nowa struktura dla klocków
 struct Block {
@@ -78,7 +297,13 @@ struct Block {
     Vec3 size; // Wymiary klocka (np. 1.0f, 1.0f, 1.0f dla sześcianu)
     float mass;  // nie uzywane obecnie
     float restitution;  // nie uzywane obecnie
-    GLuint textureID; // ID tekstury dla tego konkretnego klocka
+    TextureHandle texture; // uchwyt tekstury klocka (TextureManager)
+    Vec3 rotation = { 0,0,0 }; // Obrot klocka w stopniach wokol osi X, Y, Z
+
+    // Wyliczane w updateBlockOrientation() - nie ustawiac recznie
+    Mat3 orientation = Mat3::identity();    // lokalny -> swiat
+    Mat3 invOrientation = Mat3::identity(); // swiat -> lokalny (transpozycja)
+    bool rotated = false; // false = szybka sciezka AABB
 };
 
 // Struktura do przechowywania informacji o kolizji
@@ -91,7 +316,47 @@ struct CollisionInfo {
 // Globalne zmienne dla obiektów gry
 Projectile proj;
 bool isRunning = false;
-std::vector<Block> blocks; // Lista klocków
+// Klocki sceny jako ciagla tablica (widok jak span): albo wlasny wektor (scena
+// wbudowana / tekstowa), albo tablica zmapowana wprost z pliku .rzsc.
+// Plik binarny ma dokladnie uklad Block, wiec Block musi byc trywialnie kopiowalny
+static_assert(std::is_trivially_copyable<Block>::value, "Block jest zapisywany do pliku sceny bajt po bajcie");
+
+class BlockStore {
+public:
+    Block* begin() { return first; }
+    Block* end() { return first + count; }
+    const Block* begin() const { return first; }
+    const Block* end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    Block& operator[](size_t i) { return first[i]; }
+    const Block& operator[](size_t i) const { return first[i]; }
+
+    void assign(std::vector<Block>&& blocks) {
+        mapped.reset();
+        owned = std::move(blocks);
+        first = owned.data();
+        count = owned.size();
+    }
+
+    // Przejmuje mapowanie; n klockow zaczyna sie offset bajtow od poczatku pliku
+    void assignMapped(std::unique_ptr<MappedFile> file, size_t offset, size_t n) {
+        owned.clear();
+        mapped = std::move(file);
+        first = (Block*)(mapped->mutableData() + offset);
+        count = n;
+    }
+
+private:
+    std::vector<Block> owned;
+    std::unique_ptr<MappedFile> mapped;
+    Block* first = nullptr;
+    size_t count = 0;
+};
+
+BlockStore blocks; // Lista klocków
+bool sceneFromFile = false; // klocki z --scene (albo brak - --world) zamiast sceny wbudowanej
+bool blockInstanceDataDirty = true; // blocks zmienione - trzeba ponownie wyslac dane instancji na GPU
 
 float gravity = 9.81f;
 float velocity = 50.0f, angle = 45.0f, mass = 1.0f, drag = 0.01f;
@@ -100,8 +365,219 @@ float launchYaw = 0.0f; // Kąt obrotu wokół osi Y dla pocisku
 
 // NOWA ZMIENNA: Współczynnik tłumienia/hamowania (bliżej 0 = szybciej zwalnia, 1.0 = brak spowolnienia)
 float dampingFactor = 0.99f; // Domyślnie 0.99f, możesz dostosować
+// Hamowanie ciagle w czasie: dampingFactor dotyczy kroku przy dampingReferenceHz,
+// dla dowolnego dt mnoznik to dampingFactor^(dt * dampingReferenceHz)
+bool timeContinuousDamping = true;
+const float dampingReferenceHz = 60.0f;
+
+int maxTrailPoints = 100; // dlugosc sladu pocisku w punktach
+
+// Kompensowane (Kahan) sumowanie pozycji - mniejszy blad przy tysiacach krokow
+bool compensatedPositions = false;
+
+// Bilans energii pocisku dla jednego rzutu [J].
+// Straty sa dodatnie, gdy energia ubywa; dryf to energia, ktorej nie tlumaczy
+// zaden z modelowanych mechanizmow - czyli blad calkowania dla danego dt.
+struct EnergyStats {
+    double initialEnergy = 0.0;
+    double kinetic = 0.0;
+    double potential = 0.0;
+    double lostDrag = 0.0;        // praca oporu powietrza (i wiatru, moze byc ujemna)
+    double lostDamping = 0.0;     // wspolczynnik hamowania
+    double lostRestitution = 0.0; // odbicia od ziemi i klockow
+    double maxStepDrift = 0.0;    // najwiekszy blad bilansu w pojedynczym kroku
+    double totalDrift = 0.0;      // skumulowany blad bilansu
+    int steps = 0;
+};
+EnergyStats energyStats;
+bool recordEnergy = false; // bilans kosztuje kilkadziesiat ns na krok - tylko na zadanie
+float simTime = 0.0f; // czas symulacji od startu rzutu [s]
+
+// Zdarzenie odbicia pocisku od ziemi albo klocka
+struct CollisionEvent {
+    float time;      // czas symulacji [s]
+    Vec3 pos;        // pozycja pocisku po rozwiazaniu kolizji
+    Vec3 normal;     // normalna kontaktu
+    float impulse;   // wartosc popedu przekazanego w odbiciu [N*s]
+    int blockIndex;  // indeks w blocks albo w kafelku swiata, -1 = ziemia
+    bool inTile;     // klocek kafelka (tileX, tileZ) - ten sam numer w kazdym uruchomieniu
+    int tileX, tileZ;
+};
+
+// "ziemia", "klocek 3" albo "klocek 3 kafelka (1,-2)"
+std::string describeEventTarget(const CollisionEvent& e) {
+    if (e.blockIndex < 0) return "ziemia";
+    std::string text = "klocek " + std::to_string(e.blockIndex);
+    if (e.inTile) text += " kafelka (" + std::to_string(e.tileX) + "," + std::to_string(e.tileZ) + ")";
+    return text;
+}
+
+// Bezblokadowa kolejka jeden producent / jeden konsument o stalym rozmiarze;
+// pelna kolejka gubi nowe zdarzenia zamiast blokowac fizyke.
+template <typename T, size_t N>
+class SpscQueue {
+    static_assert((N & (N - 1)) == 0, "Rozmiar kolejki musi byc potega 2");
+    T items[N];
+    std::atomic<size_t> head{ 0 }, tail{ 0 };
+    std::atomic<size_t> dropped{ 0 };
+public:
+    bool push(const T& item) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h - tail.load(std::memory_order_acquire) == N) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        items[h & (N - 1)] = item;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+    bool pop(T& out) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t == head.load(std::memory_order_acquire)) return false;
+        out = items[t & (N - 1)];
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+    size_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+};
 
-glm::vec3 cameraPos = glm::vec3(0.0f, 20.0f, 100.0f);
+// Bufor zdarzen watku: kazdy watek ma wlasna kolejke (thread_local), do ktorej pisze
+// stepProjectile i ktora oproznia ten sam watek - petla okna (lista odbic w UI) albo
+// runHeadless (wypis wynikow). Inne watki nie maja do niej dostepu
+typedef SpscQueue<CollisionEvent, 1024> CollisionEventQueue;
+CollisionEventQueue& localCollisionEvents() {
+    thread_local CollisionEventQueue queue;
+    return queue;
+}
+
+// Warunki wczesnego zakonczenia rzutu sprawdzane po kazdym zdarzeniu
+struct RunCounters {
+    int bounces = 0;   // wszystkie odbicia (ziemia + klocki)
+    int blockHits = 0; // odbicia od klockow
+};
+RunCounters runCounters;
+typedef std::function<bool(const CollisionEvent&, const RunCounters&)> StopPredicate;
+std::vector<StopPredicate> stopPredicates;
+
+bool stopOnFirstBlockHit = false;
+int stopAfterBounces = 0; // 0 = wylaczone
+const float minEventNormalSpeed = 0.5f; // wolniejsze kontakty (toczenie) nie sa zdarzeniami
+bool collisionEventsEnabled = true; // wylaczane w --benchmark, zeby mierzyc samo calkowanie
+
+StopPredicate stopAfterFirstBlockHitPredicate() {
+    return [](const CollisionEvent& e, const RunCounters&) { return e.blockIndex >= 0; };
+}
+StopPredicate stopAfterBouncesPredicate(int n) {
+    return [n](const CollisionEvent&, const RunCounters& c) { return c.bounces >= n; };
+}
+
+// Buduje liste warunkow z ustawien (panel albo argumenty trybu bez okna)
+void applyStopSettings() {
+    stopPredicates.clear();
+    if (stopOnFirstBlockHit) stopPredicates.push_back(stopAfterFirstBlockHitPredicate());
+    if (stopAfterBounces > 0) stopPredicates.push_back(stopAfterBouncesPredicate(stopAfterBounces));
+}
+
+std::deque<CollisionEvent> recentEvents; // ostatnie zdarzenia do wyswietlenia w panelu
+
+// Wykrywanie spoczynku: pocisk podparty (ziemia albo gorna sciana klocka),
+// ktorego energia kinetyczna na kg pozostaje ponizej progu przez restTimeWindow,
+// zostaje uspiony
+float restEnergyThreshold = 0.02f; // [J/kg], odpowiada predkosci 0.2 m/s
+float restTimeWindow = 0.25f;      // [s]
+const float supportNormalMinY = 0.7f; // kontakt z normalna bardziej pionowa niz ~45 stopni podpiera pocisk
+const float contactSkin = 0.01f; // pocisk blizej niz tyle od ziemi / klocka jest podparty (mikroodbicia)
+
+// Model oporu: prosty (drag * v * v_wektor) albo Cd(Mach) z tablic balistycznych
+enum DragModel { DRAG_SIMPLE = 0, DRAG_G1, DRAG_G7 };
+int dragModel = DRAG_SIMPLE;
+float referenceDiameter = 0.1f; // srednica odniesienia pocisku dla modeli G1/G7 [m]
+const float seaLevelAirDensity = 1.225f; // [kg/m^3]
+
+// Rotacja pocisku i efekt Magnusa
+bool spinEnabled = false;
+float launchBackspin = 30.0f;  // rotacja wsteczna przy wystrzale [rad/s]
+float launchSidespin = 0.0f;   // rotacja boczna przy wystrzale [rad/s]
+float magnusCoefficient = 0.002f; // sila Magnusa = wspolczynnik * (spin x v_wzgl)
+float spinDecayRate = 0.1f;   // zanik rotacji [1/s]
+
+// Model wiatru - wiatr wchodzi do oporu jako predkosc wzgledna pocisku
+enum WindMode { WIND_NONE = 0, WIND_UNIFORM, WIND_LAYERED, WIND_GRID };
+int windMode = WIND_NONE;
+Vec3 windUniform = { 5.0f, 0.0f, 0.0f };
+
+// Warstwy wiatru posortowane rosnaco po wysokosci, interpolacja liniowa miedzy nimi
+struct WindLayer {
+    float altitude;
+    Vec3 wind;
+};
+std::vector<WindLayer> windLayers = {
+    { 0.0f,   { 0.0f, 0.0f, 0.0f } },
+    { 10.0f,  { 3.0f, 0.0f, 1.0f } },
+    { 50.0f,  { 8.0f, 0.0f, 2.0f } },
+    { 150.0f, { 12.0f, 0.0f, 4.0f } }
+};
+
+// Siatka 3D wiatru probkowana trojliniowo.
+// Wezly sa ulozone w bloki 4x4x4 (brick), wiec 8 probek jednego zapytania
+// lezy prawie zawsze w jednym ciaglym kawalku pamieci (64 * 12 B), a nie
+// w 4 odleglych wierszach jak przy ukladzie x-y-z dla duzej siatki.
+struct WindGrid {
+    static const int BRICK = 4;
+    Vec3 origin = { 0,0,0 };
+    float cellSize = 1.0f, invCellSize = 1.0f;
+    int nx = 0, ny = 0, nz = 0;    // liczba wezlow
+    int bx = 0, by = 0, bz = 0;    // liczba brickow
+    std::vector<Vec3> data;
+
+    void init(const Vec3& gridOrigin, float cell, int sizeX, int sizeY, int sizeZ) {
+        origin = gridOrigin;
+        cellSize = cell;
+        invCellSize = 1.0f / cell;
+        nx = std::max(1, sizeX); ny = std::max(1, sizeY); nz = std::max(1, sizeZ);
+        bx = (nx + BRICK - 1) / BRICK;
+        by = (ny + BRICK - 1) / BRICK;
+        bz = (nz + BRICK - 1) / BRICK;
+        data.assign((size_t)bx * by * bz * BRICK * BRICK * BRICK, Vec3{ 0,0,0 });
+    }
+    bool empty() const { return data.empty(); }
+
+    size_t index(int x, int y, int z) const {
+        size_t brick = ((size_t)(z / BRICK) * by + (y / BRICK)) * bx + (x / BRICK);
+        int local = ((z % BRICK) * BRICK + (y % BRICK)) * BRICK + (x % BRICK);
+        return brick * (BRICK * BRICK * BRICK) + local;
+    }
+    void set(int x, int y, int z, const Vec3& v) { data[index(x, y, z)] = v; }
+
+    // Poza siatka wartosci sa przyciete do krawedzi. Os z jednym wezlem (nx == 1)
+    // nie ma interpolacji - obaj sasiedzi to ten sam wezel
+    Vec3 sample(const Vec3& p) const {
+        float gx = std::max(0.0f, std::min((p.x - origin.x) * invCellSize, (float)(nx - 1)));
+        float gy = std::max(0.0f, std::min((p.y - origin.y) * invCellSize, (float)(ny - 1)));
+        float gz = std::max(0.0f, std::min((p.z - origin.z) * invCellSize, (float)(nz - 1)));
+        int x0 = std::max(0, std::min((int)gx, nx - 2)), y0 = std::max(0, std::min((int)gy, ny - 2)), z0 = std::max(0, std::min((int)gz, nz - 2));
+        int x1 = std::min(x0 + 1, nx - 1), y1 = std::min(y0 + 1, ny - 1), z1 = std::min(z0 + 1, nz - 1);
+        float fx = gx - x0, fy = gy - y0, fz = gz - z0;
+
+        Vec3 c00 = data[index(x0, y0, z0)] * (1 - fx) + data[index(x1, y0, z0)] * fx;
+        Vec3 c10 = data[index(x0, y1, z0)] * (1 - fx) + data[index(x1, y1, z0)] * fx;
+        Vec3 c01 = data[index(x0, y0, z1)] * (1 - fx) + data[index(x1, y0, z1)] * fx;
+        Vec3 c11 = data[index(x0, y1, z1)] * (1 - fx) + data[index(x1, y1, z1)] * fx;
+        Vec3 c0 = c00 * (1 - fy) + c10 * fy;
+        Vec3 c1 = c01 * (1 - fy) + c11 * fy;
+        return c0 * (1 - fz) + c1 * fz;
+    }
+};
+WindGrid windGrid;
+
+// Gestosc powietrza zalezna od wysokosci (atmosfera wzorcowa, troposfera)
+bool useAirDensityModel = false;
+float seaLevelTemperature = 288.15f; // [K]
+float temperatureLapseRate = 0.0065f; // spadek temperatury [K/m]
+
+// Pozycja kamery w double - renderowanie odbywa sie wzgledem kamery,
+// wiec do GPU trafiaja tylko male wspolrzedne we float (brak drgan przy duzym swiecie)
+glm::dvec3 cameraPos = glm::dvec3(0.0, 20.0, 100.0);
 glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
 glm::vec3 cameraUp = glm::vec3(0.0f, 1.0f, 0.0f);
 
@@ -113,15 +589,226 @@ float pitch = 0.0f;
 bool freeCameraMode = true; // true = tryb swobodnej kamery, false = tryb statyczny
 bool zKeyPressedLastFrame = false; // Pomocnicza zmienna do wykrywania naciśnięcia klawisza 'Z'
 
-// Globalna mapa do przechowywania ID tekstur
-std::map<std::string, GLuint> textures;
-GLuint textureIDProjectile; // ID tekstury dla pocisku
+// Menedzer tekstur: obrazki tego samego rozmiaru sa warstwami jednej tablicy
+// GL_TEXTURE_2D_ARRAY, a reszta programu zna tylko male uchwyty (indeksy slotow).
+// Sciezki sa potrzebne tylko przy rejestracji - w klatce nie ma szukania po napisach.
+// Ladowanie jest asynchroniczne: watki robocze dekoduja JPG, a watek glowny w pump()
+// wysyla co klatke ograniczona liczbe bajtow przez PBO. Do tego czasu uchwyt
+// pokazuje zastepcza teksture (placeholder).
+struct TextureArray {
+    GLuint id = 0;
+    int width = 0, height = 0;
+    int layers = 0;
+};
+
+enum TextureState { TEXTURE_PENDING = 0, TEXTURE_READY, TEXTURE_FAILED };
+
+struct TextureSlot {
+    int array = -1; // indeks w arrays
+    int layer = 0;
+    int state = TEXTURE_PENDING;
+};
+
+// Obrazek przygotowany przez watek roboczy, czekajacy na wyslanie na GPU:
+// zdekodowany JPG albo zmapowany plik z cache, w obu przypadkach z mipmapami
+struct DecodedTexture {
+    TextureHandle handle = NO_TEXTURE;
+    int width = 0, height = 0, levels = 0;
+    const unsigned char* data = nullptr;  // RGBA8, poziomy jeden za drugim; nullptr = blad
+    std::vector<unsigned char> pixels;    // wlasne dane (swiezo zdekodowane)
+    std::unique_ptr<MappedFile> mapped;   // albo widok na plik cache
+};
+
+// Plik cache tekstury: naglowek + poziomy mipmap RGBA8 bez odstepow.
+// Klucz to FNV-1a zawartosci pliku zrodlowego, wiec zmieniony JPG daje nowy wpis
+struct TextureCacheHeader {
+    char magic[4];      // "RZTX"
+    uint32_t version;
+    uint64_t sourceHash;
+    uint32_t width, height, levels, reserved;
+};
+const uint32_t TEXTURE_CACHE_VERSION = 1;
+bool useTextureCache = true;
+const char* textureCacheDir = "texture_cache";
+
+int mipLevelCount(int width, int height) {
+    int levels = 1;
+    for (int size = std::max(width, height); size > 1; size >>= 1) ++levels;
+    return levels;
+}
+
+// Laczny rozmiar lancucha mipmap RGBA8
+size_t mipChainBytes(int width, int height, int levels) {
+    size_t bytes = 0;
+    for (int l = 0; l < levels; ++l) bytes += (size_t)std::max(1, width >> l) * std::max(1, height >> l) * 4;
+    return bytes;
+}
+
+struct TextureManager {
+    std::vector<TextureArray> arrays;
+    std::vector<TextureSlot> slots;  // uchwyt -> tablica i warstwa
+    std::vector<std::string> paths;  // uchwyt -> plik zrodlowy
+    TextureSlot placeholder;         // szachownica 2x2 pokazywana do konca wysylania
+    // Zmapowane pliki zrodlowe: otwierane raz w startLoading() (naglowek), czytane przez
+    // dekodowanie na watku roboczym, zwalniane po odebraniu wyniku w pump()
+    std::vector<std::unique_ptr<AssetView>> sources;
+
+    // Dekodowanie (watki robocze). paths i decodeQueue nie zmieniaja sie w trakcie.
+    std::vector<std::thread> workers;
+    std::vector<TextureHandle> decodeQueue;
+    std::atomic<size_t> nextDecode{ 0 };
+    std::mutex readyMutex;
+    std::deque<DecodedTexture> ready; // chronione readyMutex
+
+    // Wysylanie (watek glowny)
+    GLuint pbo = 0;
+    DecodedTexture uploading;
+    int uploadLevel = 0;       // wysylany poziom mipmap
+    size_t uploadLevelOffset = 0; // poczatek tego poziomu w uploading.data
+    int uploadedRows = 0;
+    int pendingCount = 0;
+
+    // Rejestruje plik i zwraca jego uchwyt (ten sam dla powtorzonej sciezki).
+    // Tylko przed startLoading().
+    TextureHandle add(const char* path) {
+        for (size_t i = 0; i < paths.size(); ++i) {
+            if (paths[i] == path) return (TextureHandle)i;
+        }
+        paths.push_back(path);
+        slots.push_back(TextureSlot());
+        return (TextureHandle)(paths.size() - 1);
+    }
+
+    // false = brak tekstury albo nie udalo sie jej zaladowac (rysujemy kolorem)
+    bool valid(TextureHandle h) const { return h >= 0 && h < (TextureHandle)slots.size() && slots[h].state != TEXTURE_FAILED; }
+    // Slot do rysowania: wlasciwy albo zastepczy, jesli tekstura jeszcze nie doszla
+    const TextureSlot& resolve(TextureHandle h) const { return slots[h].state == TEXTURE_READY ? slots[h] : placeholder; }
+    GLuint arrayID(const TextureSlot& slot) const { return arrays[slot.array].id; }
+
+    void startLoading();
+    void prepare(DecodedTexture& d) const;
+    bool pump(size_t byteBudget);
+    void shutdown();
+};
+TextureManager textureManager;
+TextureHandle textureGround = NO_TEXTURE;     // Tekstura dla ziemi
+TextureHandle textureProjectile = NO_TEXTURE; // Tekstura dla pocisku
+TextureHandle texturePlaceholder1 = NO_TEXTURE, texturePlaceholder2 = NO_TEXTURE; // Tekstury klockow
+int textureUploadBudgetMB = 16; // ile MB tekstur wysylac na GPU w jednej klatce
 
 // Globalne zmienne dla VAO/VBO/EBO
 GLuint vaoGround = 0, vaoSphere = 0, vboGround = 0, vboSphere = 0, eboSphere = 0;
-GLuint vaoBlock = 0, vboBlock = 0;
+GLuint vaoBlock = 0, vboBlock = 0, eboBlock = 0;
+
+// Instancjonowane klocki: dane wszystkich klockow w buforze tekstury (samplerBuffer,
+// 4 x vec4 na klocek: trzy kolumny obrotu ze skala i przesuniecie z warstwa tekstury),
+// a co klatke tylko indeksy widocznych klockow jako atrybut instancji (layout = 3)
+GLuint vaoBlockInstanced = 0, vboBlockInstances = 0;
+GLuint tboBlockData = 0, texBlockData = 0;
+glm::dvec3 sceneInstanceAnchor = glm::dvec3(0.0); // przesuniecia instancji sceny sa wzgledem tego punktu
+std::vector<int32_t> visibleBlockIndices;
+std::vector<size_t> visibleBlockGroupStart; // poczatek grupy kazdej tablicy tekstur w visibleBlockIndices
+int blockDrawCalls = 0;
+int visibleBlockCount = 0; // scena + kafelki swiata, do okna ustawien
+
+// Pula par (bufor, tekstura bufora) na dane instancji kafelkow swiata - kafelki
+// przychodza i odchodza przy ruchu kamery, obiekty GL sa uzywane ponownie
+struct GpuBufferPool {
+    std::vector<std::pair<GLuint, GLuint>> free;
+
+    std::pair<GLuint, GLuint> acquire() {
+        if (!free.empty()) {
+            std::pair<GLuint, GLuint> entry = free.back();
+            free.pop_back();
+            return entry;
+        }
+        std::pair<GLuint, GLuint> entry;
+        glGenBuffers(1, &entry.first);
+        glGenTextures(1, &entry.second);
+        glBindBuffer(GL_TEXTURE_BUFFER, entry.first);
+        glBindTexture(GL_TEXTURE_BUFFER, entry.second);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, entry.first);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        return entry;
+    }
+    void release(GLuint buffer, GLuint texture) { free.push_back({ buffer, texture }); }
+};
+GpuBufferPool tileBufferPool;
 GLuint shaderProgram = 0;
 
+// Polozenia uniformow default.vert/.frag, pobierane raz po kazdym (prze)ladowaniu
+// programu zamiast glGetUniformLocation przy kazdym rysowaniu
+struct DefaultUniforms {
+    GLint uProjection, uView, uModel, viewPos, lightPos;
+    GLint useTexture, disableLighting, uOctNormals, uColor;
+    GLint uInstanced, uInstanceOrigin, uTextureLayer;
+    GLint uTextureArray, uInstanceData;
+};
+DefaultUniforms defaultUniforms;
+
+// Slad jako impostory: jeden wierzcholek (GL_POINTS) na punkt sladu, kula
+// liczona w fragment shaderze - caly slad to jedno wywolanie rysowania
+enum TrailStyle { TRAIL_SPHERES = 0, TRAIL_IMPOSTORS, TRAIL_RIBBON };
+int trailStyle = TRAIL_IMPOSTORS;
+GLuint impostorProgram = 0;
+struct ImpostorUniforms {
+    GLint uProjection, uView, uInvProjection, uViewport, uRadius, uColor, uOrigin;
+};
+ImpostorUniforms impostorUniforms; // jak defaultUniforms - odswiezane po przeladowaniu
+GLuint vaoTrailPoints = 0, vboTrailPoints = 0;
+// vboTrailPoints to pierscien punktow sladu zapisanych wzgledem trailPointsOrigin (float);
+// co klatke dopisujemy tylko nowe punkty (jak syncRibbon), a przesuniecie do ukladu
+// kamery idzie w uniformie. Calosc od nowa tylko przy nowym rzucie albo zmianie poczatku
+const size_t trailPointsRing = 1 << 17; // wiecej niz maksymalna dlugosc sladu (100000)
+const double trailOriginRebaseDistance = 4096.0; // dalej od poczatku - nowy poczatek (precyzja float)
+size_t trailPointsHead = 0;   // nastepne wolne miejsce w pierscieniu
+size_t trailPointsCount = 0;  // ile poprawnych punktow jest w pierscieniu
+glm::dvec3 trailPointsOrigin(0.0);
+uint64_t trailPointsSynced = 0; // trailPushed, do ktorego pierscien jest aktualny
+unsigned trailPointsEpoch = ~0u;
+std::vector<glm::vec3> trailPointsScratch; // bufor roboczy na nowe punkty
+const float trailRadius = 0.5f;
+const glm::vec4 trailColor = glm::vec4(1.0f, 0.8f, 0.2f, 0.5f);
+
+// Slad jako wstega o stalej szerokosci na ekranie. Kazdy odcinek to 6 wierzcholkow
+// (2 trojkaty) dopisywanych raz, w momencie pojawienia sie nowego punktu, do bufora
+// pierscieniowego - przy GL 4.4 trwale zmapowanego, na 3.3 przez glBufferSubData.
+// Pozycje sa zapisane wzgledem ribbonOrigin (float), przesuniecie do ukladu kamery
+// idzie w uniformie, wiec ruch kamery nie wymaga ponownego wysylania sladu.
+struct RibbonVertex {
+    glm::vec3 pos;   // koniec odcinka, do ktorego nalezy wierzcholek
+    glm::vec3 other; // drugi koniec odcinka (kierunek na ekranie)
+    float side;      // +1 / -1 - strona wstegi wzgledem kierunku pos -> other
+};
+const size_t ribbonRingSegments = 1 << 17; // wiecej niz maksymalna dlugosc sladu (100000)
+GLuint ribbonProgram = 0;
+struct RibbonUniforms {
+    GLint uProjection, uView, uOrigin, uViewportSize, uWidth, uColor;
+};
+RibbonUniforms ribbonUniforms;
+GLuint vaoRibbon = 0, vboRibbon = 0;
+RibbonVertex* ribbonMapped = nullptr; // != nullptr gdy bufor jest trwale zmapowany
+GLsync ribbonFence = 0;    // koniec ostatniego rysowania wstegi (tylko tryb zmapowany)
+size_t ribbonHead = 0;     // nastepny wolny odcinek w pierscieniu
+size_t ribbonCount = 0;    // ile poprawnych odcinkow jest w pierscieniu
+glm::dvec3 ribbonOrigin(0.0);
+uint64_t ribbonSynced = 0; // trailPushed, do ktorego wstega jest aktualna
+unsigned ribbonEpoch = ~0u;
+Vec3 ribbonLastPoint = { 0,0,0 };
+bool ribbonHasLast = false;
+float ribbonWidth = 6.0f;  // szerokosc wstegi w pikselach
+
+const glm::dvec3 lightWorldPos = glm::dvec3(0.0, 50.0, 50.0); // pozycja swiatla w ukladzie swiata
+const float groundHalfSize = 200.0f;   // polowa boku kwadratu ziemi rysowanego wokol kamery
+const float groundTexturePeriod = 2.0f; // co tyle metrow powtarza sie tekstura ziemi
+
+// Przesuniecie punktu swiata do ukladu o srodku w kamerze - odejmowanie w double,
+// dopiero wynik (maly) jest zamieniany na float
+glm::vec3 cameraRelative(double x, double y, double z) {
+    return glm::vec3(glm::dvec3(x, y, z) - cameraPos);
+}
+
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     if (freeCameraMode) { // Tylko jeśli jesteśmy w trybie swobodnej kamery
@@ -178,21 +865,39 @@ void processInput(GLFWwindow* window, float deltaTime) {
     if (freeCameraMode) { // Tylko jeśli jesteśmy w trybie swobodnej kamery
         float speed = 50.0f * deltaTime;
         if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-            cameraPos += speed * cameraFront;
+            cameraPos += glm::dvec3(speed * cameraFront);
         if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-            cameraPos -= speed * cameraFront;
+            cameraPos -= glm::dvec3(speed * cameraFront);
         if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-            cameraPos -= glm::normalize(glm::cross(cameraFront, cameraUp)) * speed;
+            cameraPos -= glm::dvec3(glm::normalize(glm::cross(cameraFront, cameraUp)) * speed);
         if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-            cameraPos += glm::normalize(glm::cross(cameraFront, cameraUp)) * speed;
+            cameraPos += glm::dvec3(glm::normalize(glm::cross(cameraFront, cameraUp)) * speed);
     }
 }
 
 float toRadians(float degrees) { return degrees * M_PI / 180.0f; }
 
-// Funkcja do inicjalizacji klocków
+// Przelicza macierze orientacji klocka z katow Eulera (kolejnosc Y * X * Z)
+// Odwrotnosc liczona raz tutaj, zeby test kolizji nie robil tego w kazdym kroku
+void updateBlockOrientation(Block& block) {
+    block.rotated = block.rotation.x != 0.0f || block.rotation.y != 0.0f || block.rotation.z != 0.0f;
+    if (!block.rotated) {
+        block.orientation = Mat3::identity();
+        block.invOrientation = Mat3::identity();
+        return;
+    }
+    float rx = toRadians(block.rotation.x), ry = toRadians(block.rotation.y), rz = toRadians(block.rotation.z);
+    Mat3 rotX = { { { 1,0,0 }, { 0, std::cos(rx), -std::sin(rx) }, { 0, std::sin(rx), std::cos(rx) } } };
+    Mat3 rotY = { { { std::cos(ry), 0, std::sin(ry) }, { 0,1,0 }, { -std::sin(ry), 0, std::cos(ry) } } };
+    Mat3 rotZ = { { { std::cos(rz), -std::sin(rz), 0 }, { std::sin(rz), std::cos(rz), 0 }, { 0,0,1 } } };
+    block.orientation = rotY * rotX * rotZ;
+    block.invOrientation = block.orientation.transposed();
+}
+
+// Funkcja do inicjalizacji klocków - raz przy starcie, nie przy kazdym Reset
 void initBlocks() {
-    blocks.clear();
+    if (sceneFromFile) return; // scena z pliku jest juz zaladowana w loadScene()
+    std::vector<Block> built;
     // Stały rozmiar i parametry dla statycznych klocków
     float blockSize = 10.0f;
     // Masa i restytucja dla klocków statycznych nie mają znaczenia
@@ -201,45 +906,671 @@ void initBlocks() {
 
     // Zwiększone odległości X i Z, aby klocki były jeszcze dalej od środka
     // Przypisanie tekstur do klocków
-    blocks.push_back({ {30, blockSize * 0.5f, 25}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, textures["textures/placeholder1.jpg"] });
-    blocks.push_back({ {-30, blockSize * 0.5f, -25}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, textures["textures/placeholder2.jpg"] });
-    blocks.push_back({ {25, blockSize * 0.5f, -30}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, textures["textures/placeholder1.jpg"] });
-    blocks.push_back({ {0, blockSize * 0.5f, 30}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, textures["textures/placeholder2.jpg"] });
-    blocks.push_back({ {-25, blockSize * 0.5f, 0}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, textures["textures/placeholder1.jpg"] });
+    built.push_back({ {30, blockSize * 0.5f, 25}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, texturePlaceholder1 });
+    built.push_back({ {-30, blockSize * 0.5f, -25}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, texturePlaceholder2 });
+    built.push_back({ {25, blockSize * 0.5f, -30}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, texturePlaceholder1 });
+    built.push_back({ {0, blockSize * 0.5f, 30}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, texturePlaceholder2 });
+    built.push_back({ {-25, blockSize * 0.5f, 0}, {0,0,0}, {blockSize, blockSize, blockSize}, blockMass, blockRestitution, texturePlaceholder1 });
+    // Obrocony klocek (OBB)
+    built.push_back({ {40, blockSize * 0.5f, -5}, {0,0,0}, {blockSize, blockSize, blockSize * 0.5f}, blockMass, blockRestitution, texturePlaceholder2, {0, 35.0f, 0} });
+
+    for (auto& block : built) updateBlockOrientation(block);
+    blocks.assign(std::move(built));
+    blockInstanceDataDirty = true;
 }
 
+// Format sceny. Postac tekstowa (do pisania recznie), linia po linii:
+//   # komentarz
+//   texture <nazwa> <plik>                       - tekstura dostepna pod nazwa
+//   mass <m> / restitution <r>                   - dla kolejnych klockow
+//   block <x> <y> <z> <sx> <sy> <sz> <nazwa|-> [<rx> <ry> <rz>]
+// Postac binarna (.rzsc, --compile-scene): naglowek, tabela sciezek tekstur i tablica
+// Block w ukladzie pamieci programu (z policzona orientacja), gdzie Block::texture to
+// indeks w tabeli. Wczytanie to mmap i podmiana indeksow na uchwyty TextureManager.
+struct SceneHeader {
+    char magic[4]; // "RZSC"
+    uint32_t version;
+    uint32_t blockSize; // sizeof(Block) programu, ktory zapisal plik
+    uint32_t blockCount;
+    uint32_t textureCount;
+    uint32_t textureTableOffset;
+    uint32_t blocksOffset;
+    uint32_t reserved;
+};
+const uint32_t SCENE_VERSION = 1;
+const size_t SCENE_TEXTURE_PATH_SIZE = 128; // staly rozmiar wpisu w tabeli tekstur
 
-void reset() {
+// Scena przed przypisaniem uchwytow: Block::texture to indeks w textures
+struct SceneSource {
+    std::vector<std::string> textures;
+    std::vector<Block> blocks;
+};
+
+SceneSource parseSceneText(const char* path) {
+    AssetView file(path);
+    std::istringstream in(std::string(file.chars(), file.size()));
+    SceneSource scene;
+    std::vector<std::string> textureNames;
+    float blockMass = 10.0f, blockRestitution = 0.5f;
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); ++lineNumber) {
+        std::istringstream tokens(line);
+        std::string keyword;
+        if (!(tokens >> keyword) || keyword[0] == '#') continue;
+        bool ok = true;
+        if (keyword == "texture") {
+            std::string name, texturePath;
+            ok = (bool)(tokens >> name >> texturePath) && texturePath.size() < SCENE_TEXTURE_PATH_SIZE;
+            textureNames.push_back(name);
+            scene.textures.push_back(texturePath);
+        }
+        else if (keyword == "mass") ok = (bool)(tokens >> blockMass);
+        else if (keyword == "restitution") ok = (bool)(tokens >> blockRestitution);
+        else if (keyword == "block") {
+            Block block = {};
+            std::string textureName;
+            ok = (bool)(tokens >> block.pos.x >> block.pos.y >> block.pos.z >> block.size.x >> block.size.y >> block.size.z >> textureName);
+            // Obrot opcjonalny, ale wtedy wszystkie trzy katy; niepelny albo nadmiarowy to blad
+            if (ok && !(tokens >> std::ws).eof()) {
+                std::string extra;
+                ok = (bool)(tokens >> block.rotation.x >> block.rotation.y >> block.rotation.z) && !(tokens >> extra);
+            }
+            block.vel = { 0,0,0 };
+            block.mass = blockMass;
+            block.restitution = blockRestitution;
+            block.texture = NO_TEXTURE;
+            if (ok && textureName != "-") {
+                auto it = std::find(textureNames.begin(), textureNames.end(), textureName);
+                ok = it != textureNames.end();
+                if (ok) block.texture = (TextureHandle)(it - textureNames.begin());
+            }
+            updateBlockOrientation(block);
+            scene.blocks.push_back(block);
+        }
+        else ok = false;
+        if (!ok) throw AssetError(path, "Blad w linii " + std::to_string(lineNumber));
+    }
+    return scene;
+}
+
+void writeSceneBinary(const char* path, const SceneSource& scene) {
+    SceneHeader header = {};
+    std::memcpy(header.magic, "RZSC", 4);
+    header.version = SCENE_VERSION;
+    header.blockSize = (uint32_t)sizeof(Block);
+    header.blockCount = (uint32_t)scene.blocks.size();
+    header.textureCount = (uint32_t)scene.textures.size();
+    header.textureTableOffset = (uint32_t)sizeof(SceneHeader);
+    // Tablica klockow wyrownana do 16 bajtow (mapowanie zaczyna sie na granicy strony)
+    header.blocksOffset = (uint32_t)((header.textureTableOffset + scene.textures.size() * SCENE_TEXTURE_PATH_SIZE + 15) & ~(size_t)15);
+
+    std::ofstream out(path, std::ios::binary);
+    if (!out) throw AssetError(path, "Nie mozna zapisac pliku");
+    out.write((const char*)&header, sizeof(header));
+    for (const std::string& texturePath : scene.textures) {
+        char entry[SCENE_TEXTURE_PATH_SIZE] = {};
+        std::memcpy(entry, texturePath.c_str(), std::min(texturePath.size(), SCENE_TEXTURE_PATH_SIZE - 1));
+        out.write(entry, sizeof(entry));
+    }
+    const char padding[16] = {};
+    out.write(padding, header.blocksOffset - (header.textureTableOffset + scene.textures.size() * SCENE_TEXTURE_PATH_SIZE));
+    out.write((const char*)scene.blocks.data(), (std::streamsize)(scene.blocks.size() * sizeof(Block)));
+    if (!out) throw AssetError(path, "Blad zapisu");
+}
+
+// Zamiana indeksow tekstur z pliku na uchwyty menedzera. Scena wczytana przed
+// innymi teksturami dostaje uchwyty 0..n-1 - wtedy nic nie trzeba zmieniac i zadna
+// strona mapowania nie jest kopiowana
+void applyTextureRemap(Block* first, size_t count, const std::vector<TextureHandle>& remap) {
+    bool identity = true;
+    for (size_t i = 0; i < remap.size(); ++i) identity = identity && remap[i] == (TextureHandle)i;
+    if (identity) return;
+    for (size_t i = 0; i < count; ++i) {
+        TextureHandle t = first[i].texture;
+        first[i].texture = t >= 0 && t < (TextureHandle)remap.size() ? remap[t] : NO_TEXTURE;
+    }
+}
+
+void fixupSceneTextures(Block* first, size_t count, const std::vector<std::string>& texturePaths) {
+    std::vector<TextureHandle> remap;
+    for (const std::string& texturePath : texturePaths) remap.push_back(textureManager.add(texturePath.c_str()));
+    applyTextureRemap(first, count, remap);
+}
+
+// Mapuje plik .rzsc (kopia przy zapisie - pod podmiane tekstur) i sprawdza naglowek.
+// Bez dostepu do stanu globalnego, wiec mozna wolac z watku wczytujacego kafelki
+std::unique_ptr<MappedFile> mapSceneBinary(const char* path, SceneHeader& header, std::vector<std::string>& texturePaths) {
+    std::unique_ptr<MappedFile> file(new MappedFile());
+    if (!file->open(path, true)) throw AssetError(path, "Nie mozna otworzyc pliku");
+    if (file->size() < sizeof(header)) throw AssetError(path, "Plik sceny za krotki");
+    std::memcpy(&header, file->data(), sizeof(header));
+    if (std::memcmp(header.magic, "RZSC", 4) != 0 || header.version != SCENE_VERSION)
+        throw AssetError(path, "Nieznany format sceny");
+    if (header.blockSize != sizeof(Block))
+        throw AssetError(path, "Uklad Block sie zmienil - skompiluj scene ponownie (--compile-scene)");
+    if (header.blocksOffset % alignof(Block) != 0
+        || (size_t)header.textureTableOffset + (size_t)header.textureCount * SCENE_TEXTURE_PATH_SIZE > header.blocksOffset
+        || file->size() != (size_t)header.blocksOffset + (size_t)header.blockCount * sizeof(Block))
+        throw AssetError(path, "Uszkodzony plik sceny");
+
+    texturePaths.clear();
+    for (uint32_t i = 0; i < header.textureCount; ++i) {
+        const char* entry = (const char*)file->data() + header.textureTableOffset + i * SCENE_TEXTURE_PATH_SIZE;
+        texturePaths.push_back(std::string(entry, strnlen(entry, SCENE_TEXTURE_PATH_SIZE)));
+    }
+    return file;
+}
+
+void loadSceneBinary(const char* path) {
+    SceneHeader header;
+    std::vector<std::string> texturePaths;
+    std::unique_ptr<MappedFile> file = mapSceneBinary(path, header, texturePaths);
+    fixupSceneTextures((Block*)(file->mutableData() + header.blocksOffset), header.blockCount, texturePaths);
+    blocks.assignMapped(std::move(file), header.blocksOffset, header.blockCount);
+}
+
+// Scena z pliku (.rzsc - binarna, inne - tekstowa). Przed initGL(), zeby tekstury
+// sceny zostaly zarejestrowane przed startem ladowania. Rzuca AssetError
+void loadScene(const char* path) {
+    std::string p = path;
+    if (p.size() >= 5 && p.compare(p.size() - 5, 5, ".rzsc") == 0) {
+        loadSceneBinary(path);
+    }
+    else {
+        SceneSource scene = parseSceneText(path);
+        fixupSceneTextures(scene.blocks.data(), scene.blocks.size(), scene.textures);
+        blocks.assign(std::move(scene.blocks));
+    }
+    sceneFromFile = true;
+    blockInstanceDataDirty = true;
+}
+
+// Swiat w kafelkach (--world <katalog>): klocki podzielone wedlug srodka na kwadraty
+// tileSize x tileSize, kazdy kafelek w osobnym pliku .rzsc. W pamieci sa tylko kafelki
+// w promieniu loadRadius + margin od kamery i pocisku; wczytuje je watek w tle, zwalnia
+// watek glowny (z histereza jednego kafelka). Katalog zawiera world.txt:
+//   tile_size <metry>
+//   margin <kafelki>    - jak daleko klocek wystaje poza kafelek swojego srodka
+//                         (razem z promieniem pocisku); domyslnie 1
+//   texture <plik>      - wspolna tabela tekstur wszystkich kafelkow
+// i pliki tile_<x>_<z>.rzsc (brak pliku = pusty kafelek). Tworzy go --compile-world.
+struct WorldTile {
+    int x = 0, z = 0;
+    std::unique_ptr<MappedFile> file; // nullptr = pusty kafelek
+    Block* blocks = nullptr;
+    size_t count = 0;
+    Vec3 boundsMin = { 0,0,0 }, boundsMax = { 0,0,0 }; // obrys klockow (kule opisane)
+    GLuint gpuBuffer = 0, gpuTexture = 0; // dane instancji, z puli (tylko z oknem)
+    bool gpuDirty = true;
+};
+
+struct WorldStreamer {
+    bool enabled = false;
+    bool synchronous = false; // tryb bez okna: wczytywanie od razu, powtarzalne wyniki
+    std::string dir;
+    float tileSize = 256.0f;
+    int loadRadius = 1;
+    int margin = 1; // z world.txt - dodawany do loadRadius, zeby klocek siegajacy do
+                    // kafelka pocisku byl w pamieci, nawet gdy jego srodek jest obok
+    std::vector<std::string> texturePaths;      // tabela z world.txt
+    std::vector<TextureHandle> textureHandles;  // ... i uchwyty menedzera (stale po openWorld)
+
+    std::vector<std::unique_ptr<WorldTile>> resident; // watek glowny
+    std::vector<std::pair<int, int>> pending;          // zlecone, jeszcze nie gotowe
+
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<std::pair<int, int>> requests;            // chronione mutex
+    std::deque<std::unique_ptr<WorldTile>> finished;     // chronione mutex
+    bool stopping = false;                               // chronione mutex
+};
+WorldStreamer world;
+
+// Zwrot buforow do puli (bez wywolan GL - dziala tez bez okna)
+void releaseTileGpu(WorldTile& tile) {
+    if (tile.gpuBuffer) tileBufferPool.release(tile.gpuBuffer, tile.gpuTexture);
+    tile.gpuBuffer = tile.gpuTexture = 0;
+}
+
+int worldTileCoord(double v) { return (int)std::floor(v / world.tileSize); }
+
+// Naroznik kafelka - kotwica przesuniec jego instancji (por. uploadBlockInstanceData)
+glm::dvec3 worldTileOrigin(const WorldTile& tile) { return glm::dvec3((double)tile.x * world.tileSize, 0.0, (double)tile.z * world.tileSize); }
+
+std::string worldTilePath(const std::string& dir, int x, int z) {
+    return dir + "/tile_" + std::to_string(x) + "_" + std::to_string(z) + ".rzsc";
+}
+
+// Watek wczytujacy: mapowanie pliku, podmiana tekstur na uchwyty, obrys kafelka
+std::unique_ptr<WorldTile> loadWorldTile(int x, int z) {
+    std::unique_ptr<WorldTile> tile(new WorldTile());
+    tile->x = x;
+    tile->z = z;
+    std::string path = worldTilePath(world.dir, x, z);
+    if (fileModificationTime(path.c_str()) == 0) return tile; // pusty kafelek
+    try {
+        SceneHeader header;
+        std::vector<std::string> texturePaths;
+        tile->file = mapSceneBinary(path.c_str(), header, texturePaths);
+        tile->blocks = (Block*)(tile->file->mutableData() + header.blocksOffset);
+        tile->count = header.blockCount;
+        std::vector<TextureHandle> remap;
+        for (const std::string& texturePath : texturePaths) {
+            auto it = std::find(world.texturePaths.begin(), world.texturePaths.end(), texturePath);
+            remap.push_back(it != world.texturePaths.end() ? world.textureHandles[it - world.texturePaths.begin()] : NO_TEXTURE);
+        }
+        applyTextureRemap(tile->blocks, tile->count, remap);
+    }
+    catch (const AssetError& e) {
+        std::cerr << e.what() << std::endl;
+        tile->file.reset();
+        tile->blocks = nullptr;
+        tile->count = 0;
+    }
+    for (size_t i = 0; i < tile->count; ++i) {
+        const Block& b = tile->blocks[i];
+        float r = 0.5f * b.size.length();
+        Vec3 lo = { b.pos.x - r, b.pos.y - r, b.pos.z - r }, hi = { b.pos.x + r, b.pos.y + r, b.pos.z + r };
+        if (i == 0) { tile->boundsMin = lo; tile->boundsMax = hi; }
+        tile->boundsMin = { std::min(tile->boundsMin.x, lo.x), std::min(tile->boundsMin.y, lo.y), std::min(tile->boundsMin.z, lo.z) };
+        tile->boundsMax = { std::max(tile->boundsMax.x, hi.x), std::max(tile->boundsMax.y, hi.y), std::max(tile->boundsMax.z, hi.z) };
+    }
+    return tile;
+}
+
+bool tileTouchesSphere(const WorldTile& tile, const Vec3& center, float radius) {
+    return tile.count > 0
+        && center.x + radius >= tile.boundsMin.x && center.x - radius <= tile.boundsMax.x
+        && center.y + radius >= tile.boundsMin.y && center.y - radius <= tile.boundsMax.y
+        && center.z + radius >= tile.boundsMin.z && center.z - radius <= tile.boundsMax.z;
+}
+
+void worldWorkerLoop() {
+    for (;;) {
+        std::pair<int, int> key;
+        {
+            std::unique_lock<std::mutex> lock(world.mutex);
+            world.wake.wait(lock, [] { return world.stopping || !world.requests.empty(); });
+            if (world.stopping) return;
+            key = world.requests.front();
+            world.requests.pop_front();
+        }
+        std::unique_ptr<WorldTile> tile = loadWorldTile(key.first, key.second);
+        std::lock_guard<std::mutex> lock(world.mutex);
+        world.finished.push_back(std::move(tile));
+    }
+}
+
+// Przed initGL() - tekstury swiata musza byc zarejestrowane przed startem ladowania.
+// Rzuca AssetError
+void openWorld(const char* dir, bool synchronous) {
+    world.dir = dir;
+    std::string indexPath = world.dir + "/world.txt";
+    AssetView index(indexPath.c_str());
+    std::istringstream in(std::string(index.chars(), index.size()));
+    std::string line;
+    for (int lineNumber = 1; std::getline(in, line); ++lineNumber) {
+        std::istringstream tokens(line);
+        std::string keyword;
+        if (!(tokens >> keyword) || keyword[0] == '#') continue;
+        bool ok = true;
+        if (keyword == "tile_size") ok = (bool)(tokens >> world.tileSize) && world.tileSize > 0.0f;
+        else if (keyword == "margin") ok = (bool)(tokens >> world.margin) && world.margin >= 0;
+        else if (keyword == "texture") {
+            std::string texturePath;
+            ok = (bool)(tokens >> texturePath);
+            world.texturePaths.push_back(texturePath);
+            world.textureHandles.push_back(textureManager.add(texturePath.c_str()));
+        }
+        else ok = false;
+        if (!ok) throw AssetError(indexPath, "Blad w linii " + std::to_string(lineNumber));
+    }
+    world.enabled = true;
+    world.synchronous = synchronous;
+    if (!synchronous) world.worker = std::thread(worldWorkerLoop);
+}
+
+void closeWorld() {
+    if (world.worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(world.mutex);
+            world.stopping = true;
+        }
+        world.wake.notify_one();
+        world.worker.join();
+    }
+    world.resident.clear();
+    world.finished.clear();
+}
+
+// Watek glowny, raz na klatke (albo krok w trybie bez okna): zleca brakujace kafelki
+// wokol punktow focus, przyjmuje wczytane i zwalnia dalekie. Zwraca true, jesli
+// zmienil sie zbior kafelkow w pamieci
+bool updateWorldStreaming(const std::vector<glm::dvec3>& focus) {
+    if (!world.enabled) return false;
+    bool changed = false;
+    int reach = world.loadRadius + world.margin;
+    auto distance = [&](int x, int z) {
+        int best = INT32_MAX;
+        for (const glm::dvec3& f : focus) {
+            best = std::min(best, std::max(std::abs(x - worldTileCoord(f.x)), std::abs(z - worldTileCoord(f.z))));
+        }
+        return best;
+    };
+    auto known = [&](int x, int z) {
+        for (auto& t : world.resident) if (t->x == x && t->z == z) return true;
+        for (auto& k : world.pending) if (k.first == x && k.second == z) return true;
+        return false;
+    };
+
+    // Zwalnianie dalekich kafelkow (reach + 1, zeby nie migaly na granicy)
+    for (size_t i = 0; i < world.resident.size();) {
+        if (distance(world.resident[i]->x, world.resident[i]->z) > reach + 1) {
+            releaseTileGpu(*world.resident[i]);
+            world.resident.erase(world.resident.begin() + i);
+            changed = true;
+        }
+        else ++i;
+    }
+
+    // Zlecenia brakujacych
+    std::vector<std::pair<int, int>> wanted;
+    for (const glm::dvec3& f : focus) {
+        int cx = worldTileCoord(f.x), cz = worldTileCoord(f.z);
+        for (int dz = -reach; dz <= reach; ++dz) {
+            for (int dx = -reach; dx <= reach; ++dx) {
+                if (!known(cx + dx, cz + dz)) {
+                    world.pending.push_back({ cx + dx, cz + dz });
+                    wanted.push_back({ cx + dx, cz + dz });
+                }
+            }
+        }
+    }
+    if (world.synchronous) {
+        for (auto& key : wanted) {
+            std::unique_ptr<WorldTile> tile = loadWorldTile(key.first, key.second);
+            std::lock_guard<std::mutex> lock(world.mutex);
+            world.finished.push_back(std::move(tile));
+        }
+    }
+    else if (!wanted.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(world.mutex);
+            world.requests.insert(world.requests.end(), wanted.begin(), wanted.end());
+        }
+        world.wake.notify_one();
+    }
+
+    // Przyjecie wczytanych; kafelek, ktory w miedzyczasie przestal byc potrzebny, od razu idzie precz
+    std::deque<std::unique_ptr<WorldTile>> done;
+    {
+        std::lock_guard<std::mutex> lock(world.mutex);
+        done.swap(world.finished);
+    }
+    for (auto& tile : done) {
+        world.pending.erase(std::remove(world.pending.begin(), world.pending.end(), std::make_pair(tile->x, tile->z)), world.pending.end());
+        if (distance(tile->x, tile->z) > reach + 1) continue;
+        world.resident.push_back(std::move(tile));
+        changed = true;
+    }
+    return changed;
+}
+
+size_t worldResidentBlocks() {
+    size_t n = 0;
+    for (auto& t : world.resident) n += t->count;
+    return n;
+}
+
+// --compile-world: podzial sceny tekstowej na kafelki wedlug srodkow klockow.
+// Katalog musi istniec wczesniej albo dac sie utworzyc jednym poziomem
+void compileWorld(const char* scenePath, const char* dir, float tileSize) {
+    SceneSource scene = parseSceneText(scenePath);
+    std::map<std::pair<int, int>, SceneSource> tiles;
+    float reach = 0.0f; // najdalszy zasieg klocka poza jego srodek, z promieniem pocisku
+    for (const Block& block : scene.blocks) {
+        SceneSource& tile = tiles[{ (int)std::floor(block.pos.x / tileSize), (int)std::floor(block.pos.z / tileSize) }];
+        tile.blocks.push_back(block);
+        reach = std::max(reach, 0.5f * block.size.length() + 0.5f);
+    }
+    makeDirectory(dir);
+    for (auto& entry : tiles) {
+        entry.second.textures = scene.textures;
+        writeSceneBinary(worldTilePath(dir, entry.first.first, entry.first.second).c_str(), entry.second);
+    }
+    std::string indexPath = std::string(dir) + "/world.txt";
+    std::ofstream index(indexPath);
+    if (!index) throw AssetError(indexPath, "Nie mozna zapisac pliku");
+    index << "tile_size " << tileSize << "\n";
+    index << "margin " << (int)std::ceil(reach / tileSize) << "\n";
+    for (const std::string& texturePath : scene.textures) index << "texture " << texturePath << "\n";
+    std::cout << "Zapisano " << scene.blocks.size() << " klockow w " << tiles.size() << " kafelkach do " << dir << std::endl;
+}
+
+
+template <typename T>
+double kineticEnergy(const Vec3T<T>& vel) { return 0.5 * mass * (double)vel.dot(vel); }
+template <typename T>
+double mechanicalEnergy(const ProjectileT<T>& p) { return kineticEnergy(p.vel) + (double)mass * gravity * p.pos.y; }
+
+// Ustawia pocisk w punkcie startu z parametrami z panelu
+template <typename T>
+void launchProjectile(ProjectileT<T>& p) {
     float radAngle = toRadians(angle);
     float radYaw = toRadians(launchYaw);
 
-    proj.pos = { 0, 0.5f, 0 };
-    proj.vel = {
-        velocity * std::cos(radAngle) * std::sin(radYaw),
-        velocity * std::sin(radAngle),
-        velocity * std::cos(radAngle) * std::cos(radYaw)
+    p.pos = { 0, (T)0.5, 0 };
+    p.vel = {
+        (T)(velocity * std::cos(radAngle) * std::sin(radYaw)),
+        (T)(velocity * std::sin(radAngle)),
+        (T)(velocity * std::cos(radAngle) * std::cos(radYaw))
     };
-    proj.trail.clear();
+    p.posCompensation = { 0,0,0 };
+    p.trail.clear();
+    p.trailEpoch++;
+    p.sleeping = false;
+    p.restTimer = 0.0f;
+
+    // Os rotacji wstecznej jest pozioma i prostopadla do kierunku rzutu,
+    // wtedy spin x v daje sile skierowana do gory
+    p.useSpin = spinEnabled;
+    Vec3 horizontalDir = { std::sin(radYaw), 0.0f, std::cos(radYaw) };
+    Vec3 up = { 0.0f, 1.0f, 0.0f };
+    p.spin = spinEnabled ? horizontalDir.cross(up) * launchBackspin + up * launchSidespin : Vec3{ 0,0,0 };
+}
+
+// Zeruje liczniki i statystyki rzutu (zdarzenia, bilans energii)
+template <typename T>
+void resetRunStats(const ProjectileT<T>& p) {
+    simTime = 0.0f;
+
+    runCounters = RunCounters();
+    CollisionEvent discarded;
+    while (localCollisionEvents().pop(discarded)) {}
+    recentEvents.clear();
+
+    energyStats = EnergyStats();
+    energyStats.kinetic = kineticEnergy(p.vel);
+    energyStats.potential = (double)mass * gravity * p.pos.y;
+    energyStats.initialEnergy = energyStats.kinetic + energyStats.potential;
+}
+
+// Przywraca tylko stan zmieniany przez symulacje: pocisk (z sladem) i statystyki rzutu.
+// Scena (klocki, ich orientacje, dane instancji na GPU, tekstury) jest budowana raz -
+// fizyka klockow nie modyfikuje, wiec Start/Reset nie zalezy od rozmiaru sceny
+void reset() {
+    launchProjectile(proj);
     isRunning = false;
+    resetRunStats(proj);
+}
 
-    initBlocks(); // Resetuj klocki za każdym razem
+// Przykladowa siatka wiatru nad cala ziemia: wiatr rosnacy z wysokoscia plus wir wokol srodka
+void buildDemoWindGrid() {
+    const float cell = 5.0f;
+    windGrid.init({ -200.0f, 0.0f, -200.0f }, cell, 81, 41, 81);
+    for (int z = 0; z < windGrid.nz; ++z) {
+        for (int y = 0; y < windGrid.ny; ++y) {
+            for (int x = 0; x < windGrid.nx; ++x) {
+                float wx = windGrid.origin.x + x * cell;
+                float wy = y * cell;
+                float wz = windGrid.origin.z + z * cell;
+                float r = std::sqrt(wx * wx + wz * wz) + 1.0f;
+                float swirl = 6.0f * std::exp(-r / 80.0f);
+                float shear = 0.05f * wy;
+                windGrid.set(x, y, z, { -wz / r * swirl + shear, 0.0f, wx / r * swirl });
+            }
+        }
+    }
+}
+
+Vec3 sampleWind(const Vec3& pos) {
+    switch (windMode) {
+    case WIND_UNIFORM:
+        return windUniform;
+    case WIND_LAYERED: {
+        if (windLayers.empty()) return { 0,0,0 };
+        if (pos.y <= windLayers.front().altitude) return windLayers.front().wind;
+        for (size_t i = 1; i < windLayers.size(); ++i) {
+            if (pos.y < windLayers[i].altitude) {
+                const WindLayer& a = windLayers[i - 1];
+                const WindLayer& b = windLayers[i];
+                float t = (pos.y - a.altitude) / (b.altitude - a.altitude);
+                return a.wind * (1.0f - t) + b.wind * t;
+            }
+        }
+        return windLayers.back().wind;
+    }
+    case WIND_GRID:
+        return windGrid.empty() ? Vec3{ 0,0,0 } : windGrid.sample(pos);
+    default:
+        return { 0,0,0 };
+    }
+}
+
+// Stosunek gestosci powietrza na danej wysokosci do gestosci przy ziemi
+float airDensityRatio(float altitude) {
+    if (!useAirDensityModel) return 1.0f;
+    const float g0 = 9.80665f, molarMass = 0.0289644f, gasConstant = 8.31446f;
+    float h = std::max(0.0f, altitude);
+    if (temperatureLapseRate < 1e-6f) {
+        // Atmosfera izotermiczna
+        return std::exp(-g0 * molarMass * h / (gasConstant * seaLevelTemperature));
+    }
+    float base = std::max(0.0f, 1.0f - temperatureLapseRate * h / seaLevelTemperature);
+    return std::pow(base, g0 * molarMass / (gasConstant * temperatureLapseRate) - 1.0f);
+}
+
+// Punkty (Mach, Cd) standardowych krzywych oporu - wartosci przyblizone
+struct DragPoint { float mach, cd; };
+const DragPoint dragPointsG1[] = {
+    { 0.00f, 0.2629f }, { 0.50f, 0.2032f }, { 0.70f, 0.2165f }, { 0.80f, 0.2546f },
+    { 0.90f, 0.3415f }, { 0.95f, 0.3984f }, { 1.00f, 0.4805f }, { 1.05f, 0.5427f },
+    { 1.10f, 0.5883f }, { 1.20f, 0.6337f }, { 1.30f, 0.6557f }, { 1.40f, 0.6625f },
+    { 1.60f, 0.6577f }, { 1.80f, 0.6446f }, { 2.00f, 0.6298f }, { 2.50f, 0.5968f },
+    { 3.00f, 0.5608f }, { 3.50f, 0.5285f }, { 4.00f, 0.5001f }, { 5.00f, 0.4560f }
+};
+const DragPoint dragPointsG7[] = {
+    { 0.00f, 0.1198f }, { 0.50f, 0.1197f }, { 0.70f, 0.1196f }, { 0.80f, 0.1202f },
+    { 0.90f, 0.1242f }, { 0.95f, 0.1402f }, { 1.00f, 0.3803f }, { 1.05f, 0.4015f },
+    { 1.10f, 0.4043f }, { 1.20f, 0.3973f }, { 1.50f, 0.3589f }, { 2.00f, 0.3004f },
+    { 2.50f, 0.2612f }, { 3.00f, 0.2346f }, { 4.00f, 0.1998f }, { 5.00f, 0.1830f }
+};
+
+// Krzywa Cd(Mach) przeliczona raz na rowna siatke - odczyt to jedno mnozenie
+// i interpolacja, bez wyszukiwania binarnego i bez rozgalezien (da sie wektoryzowac)
+struct DragTable {
+    static const int SIZE = 512;
+    float maxMach = 5.0f;
+    float invStep = 0.0f;
+    float cd[SIZE];
+
+    void build(const DragPoint* points, int count) {
+        maxMach = points[count - 1].mach;
+        invStep = (SIZE - 1) / maxMach;
+        int seg = 0;
+        for (int i = 0; i < SIZE; ++i) {
+            float m = i / invStep;
+            while (seg < count - 2 && m > points[seg + 1].mach) ++seg;
+            float t = (m - points[seg].mach) / (points[seg + 1].mach - points[seg].mach);
+            t = std::max(0.0f, std::min(t, 1.0f));
+            cd[i] = points[seg].cd + (points[seg + 1].cd - points[seg].cd) * t;
+        }
+    }
+    float lookup(float mach) const {
+        float f = std::max(0.0f, std::min(mach * invStep, (float)(SIZE - 1)));
+        int i = std::min((int)f, SIZE - 2);
+        float t = f - i;
+        return cd[i] + (cd[i + 1] - cd[i]) * t;
+    }
+};
+
+const DragTable& dragTableFor(int model) {
+    static DragTable g1, g7;
+    static bool built = false;
+    if (!built) {
+        g1.build(dragPointsG1, sizeof(dragPointsG1) / sizeof(dragPointsG1[0]));
+        g7.build(dragPointsG7, sizeof(dragPointsG7) / sizeof(dragPointsG7[0]));
+        built = true;
+    }
+    return model == DRAG_G7 ? g7 : g1;
+}
+
+// Predkosc dzwieku zalezna od temperatury na danej wysokosci
+float speedOfSound(float altitude) {
+    if (!useAirDensityModel) return 340.3f;
+    float temperature = std::max(150.0f, seaLevelTemperature - temperatureLapseRate * std::max(0.0f, altitude));
+    return std::sqrt(1.4f * 287.05f * temperature);
+}
+
+// Przyspieszenie pocisku: grawitacja + opor liczony od predkosci wzglednej wzgledem wiatru
+// + opcjonalnie sila Magnusa dla pociskow z rotacja
+// Pola srodowiska (wiatr, gestosc, Cd) sa gladkie i liczone we float niezaleznie od T
+template <typename T>
+Vec3T<T> computeAcceleration(const ProjectileT<T>& p) {
+    Vec3T<T> relVel = windMode == WIND_NONE ? p.vel : p.vel - vec3Cast<T>(sampleWind(vec3Cast<float>(p.pos)));
+    T speed = relVel.length();//predkosc skalarna pocisku wzgledem powietrza
+    float density = airDensityRatio((float)p.pos.y);
+    T fdrag;
+    if (dragModel == DRAG_SIMPLE) {
+        fdrag = (T)(drag * density) * speed;//oblicza opor powietrza, pilka porusza sie szybciej = wiekszy opor
+    }
+    else {
+        // F = 1/2 * rho * Cd(Mach) * A * v^2, skierowana przeciwnie do v
+        float area = 0.25f * M_PI * referenceDiameter * referenceDiameter;
+        float cd = dragTableFor(dragModel).lookup((float)speed / speedOfSound((float)p.pos.y));
+        fdrag = (T)(0.5f * seaLevelAirDensity * density * cd * area) * speed;
+    }
+    Vec3T<T> acc = {
+        -fdrag * relVel.x / mass,//wieksza masa mniejsze przyspieszenie
+        -gravity - fdrag * relVel.y / mass,
+        -fdrag * relVel.z / mass
+    };
+    if (p.useSpin) {
+        // Sila Magnusa prostopadla do osi obrotu i kierunku lotu
+        acc = acc + vec3Cast<T>(p.spin).cross(relVel) * (T)(magnusCoefficient * density / mass);
+    }
+    return acc;
 }
 
 // Funkcja do sprawdzania kolizji kula-AABB 
 // zwraca flagę kolizji, normalną i głębokość penetracji jako collisioninfor
-CollisionInfo checkCollisionSphereAABB(const Vec3& sphereCenter, float sphereRadius, const Block& block) {
+// Srodek kuli jest odejmowany od srodka klocka w typie T, dalej wszystko we float
+// na malych wspolrzednych wzglednych - precyzja nie zalezy od odleglosci od poczatku ukladu
+template <typename T>
+CollisionInfo checkCollisionSphereAABB(const Vec3T<T>& sphereCenter, float sphereRadius, const Block& block) {
     CollisionInfo info;
-    Vec3 blockMin = block.pos - block.size * 0.5f;//dolny lewy tylni rog
-    Vec3 blockMax = block.pos + block.size * 0.5f;//gorny prawy przedni rog
+    Vec3 local = vec3Cast<float>(sphereCenter - vec3Cast<T>(block.pos));
+    Vec3 blockMax = block.size * 0.5f;//gorny prawy przedni rog (dolny lewy tylni to -blockMax)
 
     // Najbliższy punkt na AABB do centrum sfery (clampowanie)
     //sprawdza czy srodek kuli znajduje sie pomiedzy sfera i tworzy punkt na powierzchni lub wewnatrz najblizej srodkowi sfery
-    float closestX = std::max(blockMin.x, std::min(sphereCenter.x, blockMax.x));
-    float closestY = std::max(blockMin.y, std::min(sphereCenter.y, blockMax.y));
-    float closestZ = std::max(blockMin.z, std::min(sphereCenter.z, blockMax.z));
+    float closestX = std::max(-blockMax.x, std::min(local.x, blockMax.x));
+    float closestY = std::max(-blockMax.y, std::min(local.y, blockMax.y));
+    float closestZ = std::max(-blockMax.z, std::min(local.z, blockMax.z));
 
     Vec3 closestPoint = { closestX, closestY, closestZ };//odleglosci od punktu do srodka sfery
-    Vec3 distanceVec = sphereCenter - closestPoint;
+    Vec3 distanceVec = local - closestPoint;
     float distanceSq = distanceVec.dot(distanceVec);
     float radiusSq = sphereRadius * sphereRadius;
 
@@ -261,62 +1592,219 @@ CollisionInfo checkCollisionSphereAABB(const Vec3& sphereCenter, float sphereRad
     return info;
 }
 
+// Kolizja kula-OBB: srodek kuli przenosimy do ukladu lokalnego klocka
+// (gotowa macierz odwrotna), tam test jest identyczny jak dla AABB
+template <typename T>
+CollisionInfo checkCollisionSphereOBB(const Vec3T<T>& sphereCenter, float sphereRadius, const Block& block) {
+    CollisionInfo info;
+    Vec3 half = block.size * 0.5f;
+    Vec3 local = block.invOrientation * vec3Cast<float>(sphereCenter - vec3Cast<T>(block.pos));
 
-void update(float dt) {
-    if (!isRunning) return;
-
-    // Fizyka pocisku
-    float speed = proj.vel.length();//predkosc skalarna pocisku
-    float fdrag = drag * speed;//oblicza opor powietrza, pilka porusza sie szybciej = wiekszy opor
-    Vec3 acc = {
-        -fdrag * proj.vel.x / mass,//wieksza masa mniejsze przyspieszenie
-        -gravity - fdrag * proj.vel.y / mass,
-        -fdrag * proj.vel.z / mass
+    Vec3 closestPoint = {
+        std::max(-half.x, std::min(local.x, half.x)),
+        std::max(-half.y, std::min(local.y, half.y)),
+        std::max(-half.z, std::min(local.z, half.z))
     };
+    Vec3 distanceVec = local - closestPoint;
+    float distanceSq = distanceVec.dot(distanceVec);
 
-    proj.vel = proj.vel + acc * dt;
-
-    proj.vel = proj.vel * dampingFactor;//wspolczynnik hamowania zmniejsza predkosc skladowych predkosci pilki w kazdym kroku czasowym
+    if (distanceSq < sphereRadius * sphereRadius) {
+        info.collided = true;
+        float distance = std::sqrt(distanceSq);
+        // Normalna liczona lokalnie i obracana z powrotem do ukladu swiata
+        if (distance > 0.0001f) {
+            info.normal = block.orientation * (distanceVec * (1.0f / distance));
+        }
+        else {
+            info.normal = block.orientation * Vec3{ 0.0f, 1.0f, 0.0f };
+        }
+        info.penetrationDepth = sphereRadius - distance;
+    }
+    return info;
+}
 
-    proj.pos = proj.pos + proj.vel * dt;
+// Wybiera test kolizji - nieobrocone klocki ida szybka sciezka AABB
+template <typename T>
+CollisionInfo checkCollisionSphereBlock(const Vec3T<T>& sphereCenter, float sphereRadius, const Block& block) {
+    return block.rotated ? checkCollisionSphereOBB(sphereCenter, sphereRadius, block)
+                         : checkCollisionSphereAABB(sphereCenter, sphereRadius, block);
+}
 
-    float sphereRadius = 0.5f; // Promień pocisku
 
-    // Kolizja pocisku z ziemią
-    if (proj.pos.y - sphereRadius <= 0.0f && proj.vel.y < 0.0f) {
-        proj.pos.y = sphereRadius; // Odsuń piłkę na powierzchnię ziemi
-        proj.vel.y = -proj.vel.y * restitution; // Odbicie, mnozy predkosc.y przez otarcie
+// Mnoznik predkosci dla kroku dt. exp() liczone tylko gdy zmieni sie dt albo
+// wspolczynnik - przy stalym kroku (tryb bez okna, staly FPS) to tylko porownanie
+struct DampingCache {
+    float factor = -1.0f, dt = -1.0f, multiplier = 1.0f;
+};
+DampingCache dampingCache;
+
+float dampingMultiplier(float dt) {
+    if (!timeContinuousDamping) return dampingFactor; // stary model: raz na wywolanie update()
+    if (dt != dampingCache.dt || dampingFactor != dampingCache.factor) {
+        dampingCache.factor = dampingFactor;
+        dampingCache.dt = dt;
+        dampingCache.multiplier = std::exp(std::log(dampingFactor) * dampingReferenceHz * dt);
     }
+    return dampingCache.multiplier;
+}
 
-    // warunek na zmianę pozycji dla trail, aby uwzględnić Z
-    if (proj.trail.empty() || std::abs(proj.pos.x - proj.trail.back().x) > 1.0f || std::abs(proj.pos.y - proj.trail.back().y) > 1.0f || std::abs(proj.pos.z - proj.trail.back().z) > 1.0f) {//dodaje trail jezeli sciezka pusta lub pilka przemiescila sie o 1.0f
-        proj.trail.push_back(proj.pos);
-        if (proj.trail.size() > 100) proj.trail.erase(proj.trail.begin());
+// Zapisuje zdarzenie odbicia i zwraca true, jesli ktorys warunek konczy rzut
+// tile - kafelek swiata klocka, nullptr dla klockow sceny i ziemi
+bool emitCollisionEvent(const Vec3& pos, const Vec3& normal, float normalSpeed, const Vec3& deltaVel, int blockIndex, const WorldTile* tile = nullptr) {
+    if (!collisionEventsEnabled || normalSpeed < minEventNormalSpeed) return false;
+    CollisionEvent e = { simTime, pos, normal, mass * deltaVel.length(), blockIndex, tile != nullptr, tile ? tile->x : 0, tile ? tile->z : 0 };
+    runCounters.bounces++;
+    if (blockIndex >= 0) runCounters.blockHits++;
+    localCollisionEvents().push(e);
+
+    bool stop = false;
+    for (auto& predicate : stopPredicates) {
+        if (predicate(e, runCounters)) stop = true;
     }
+    return stop;
+}
 
-    // Kolizje pocisku z klockami
-    for (auto& block : blocks) {
-        CollisionInfo colInfo = checkCollisionSphereAABB(proj.pos, sphereRadius, block);
+// Kolizje pocisku z ciagla tablica klockow (scena albo kafelek swiata)
+template <typename T>
+void collideBlocks(ProjectileT<T>& p, const Block* first, size_t count, const WorldTile* tile, float sphereRadius, bool& supported, bool& stopRequested) {
+    for (size_t i = 0; i < count; ++i) {
+        const Block& block = first[i];
+        // Test z promieniem powiekszonym o contactSkin: podparcie jak przy ziemi, takze
+        // w krokach miedzy mikroodbiciami; odpychanie i odbicie tylko przy prawdziwym kontakcie
+        CollisionInfo colInfo = checkCollisionSphereBlock(p.pos, sphereRadius + contactSkin, block);
         if (colInfo.collided) {
+            if (colInfo.normal.y > supportNormalMinY) supported = true; // lezy na klocku lub tuz nad nim
+            float penetrationDepth = colInfo.penetrationDepth - contactSkin;
+            if (penetrationDepth <= 0.0f) continue;
             // rozwiazanie problemu z zablokowaniem sie pilki w klocku: odsuń piłkę
             // Dodajemy mały epsilon, aby upewnić się, że piłka jest poza obiektem
-            proj.pos = proj.pos + colInfo.normal * (colInfo.penetrationDepth + 0.001f);
+            p.pos = p.pos + vec3Cast<T>(colInfo.normal * (penetrationDepth + 0.001f));
+            p.posCompensation = { 0,0,0 };
 
             // Odbicie prędkości pocisku
             // Obliczamy składową prędkości wzdłuż normalnej kolizji
-            float velAlongNormal = proj.vel.dot(colInfo.normal);
+            T velAlongNormal = p.vel.dot(vec3Cast<T>(colInfo.normal));
 
             // Tylko jeśli obiekty się do siebie zbliżają
             if (velAlongNormal < 0) {
-                Vec3 impulse = colInfo.normal * (velAlongNormal * (1.0f + restitution));
-                proj.vel = proj.vel - impulse; // Odbicie
+                Vec3 impulse = colInfo.normal * (float)(velAlongNormal * (1.0f + restitution));
+                p.vel = p.vel - vec3Cast<T>(impulse); // Odbicie
+                stopRequested |= emitCollisionEvent(vec3Cast<float>(p.pos), colInfo.normal, (float)-velAlongNormal, impulse, (int)i, tile);
             }
         }
     }
+}
+
+// Jeden krok calkowania pocisku p (poljawny Euler) razem z kolizjami.
+// Zwraca true, jesli rzut sie zakonczyl (warunek stopu albo spoczynek).
+template <typename T>
+bool stepProjectile(ProjectileT<T>& p, float dt) {
+    double energyBefore = recordEnergy ? mechanicalEnergy(p) : 0.0;
+    double stepDrag = 0.0, stepDamping = 0.0, stepRestitution = 0.0;
+
+    // Fizyka pocisku
+    Vec3T<T> acc = computeAcceleration(p);
+    Vec3T<T> velBefore = p.vel;
+
+    p.vel = p.vel + acc * dt;
+
+    if (recordEnergy) {
+        // Praca sil niezachowawczych (wszystko poza grawitacja) na sredniej predkosci kroku
+        Vec3T<T> nonConservativeAcc = { acc.x, acc.y + gravity, acc.z };
+        stepDrag = -(double)mass * nonConservativeAcc.dot((velBefore + p.vel) * (T)0.5) * dt;
+    }
+
+    if (p.useSpin) {
+        p.spin = p.spin * std::exp(-spinDecayRate * dt); // zanik rotacji przez tarcie powietrza
+    }
+
+    double kineticBeforeDamping = recordEnergy ? kineticEnergy(p.vel) : 0.0;
+    p.vel = p.vel * dampingMultiplier(dt);//wspolczynnik hamowania zmniejsza predkosc skladowych predkosci pilki proporcjonalnie do czasu kroku
+    if (recordEnergy) stepDamping = kineticBeforeDamping - kineticEnergy(p.vel);
+
+    if (compensatedPositions) {
+        // Sumowanie Kahana: posCompensation zbiera to, co zaokraglenie obcielo w poprzednich krokach
+        Vec3T<T> y = p.vel * dt - p.posCompensation;
+        Vec3T<T> t = p.pos + y;
+        p.posCompensation = (t - p.pos) - y;
+        p.pos = t;
+    }
+    else {
+        p.pos = p.pos + p.vel * dt;
+    }
+
+    double energyBeforeContacts = recordEnergy ? mechanicalEnergy(p) : 0.0;
+    float sphereRadius = 0.5f; // Promień pocisku
+
+    // Kolizja pocisku z ziemią
+    bool stopRequested = false;
+    bool supported = p.pos.y - sphereRadius <= contactSkin; // lezy na ziemi lub tuz nad nia
+    if (p.pos.y - sphereRadius <= 0.0f && p.vel.y < 0.0f) {
+        float normalSpeed = (float)-p.vel.y;
+        p.pos.y = sphereRadius; // Odsuń piłkę na powierzchnię ziemi
+        p.posCompensation.y = 0;
+        p.vel.y = -p.vel.y * restitution; // Odbicie, mnozy predkosc.y przez otarcie
+        stopRequested |= emitCollisionEvent(vec3Cast<float>(p.pos), { 0.0f, 1.0f, 0.0f }, normalSpeed, { 0.0f, normalSpeed * (1.0f + restitution), 0.0f }, -1);
+    }
+
+    // warunek na zmianę pozycji dla trail, aby uwzględnić Z
+    if (p.trail.empty() || std::abs(p.pos.x - p.trail.back().x) > 1.0f || std::abs(p.pos.y - p.trail.back().y) > 1.0f || std::abs(p.pos.z - p.trail.back().z) > 1.0f) {//dodaje trail jezeli sciezka pusta lub pilka przemiescila sie o 1.0f
+        p.trail.push_back(vec3Cast<float>(p.pos));
+        p.trailPushed++;
+        while (p.trail.size() > (size_t)maxTrailPoints) p.trail.pop_front();
+    }
+
+    // Kolizje pocisku z klockami
+    collideBlocks(p, blocks.begin(), blocks.size(), nullptr, sphereRadius, supported, stopRequested);
+    // Kafelki swiata: tylko te, ktorych obrys obejmuje pocisk
+    for (auto& tile : world.resident) {
+        if (tileTouchesSphere(*tile, vec3Cast<float>(p.pos), sphereRadius + contactSkin)) {
+            collideBlocks(p, tile->blocks, tile->count, tile.get(), sphereRadius, supported, stopRequested);
+        }
+    }
+
+    double energyAfterContacts = recordEnergy ? mechanicalEnergy(p) : 0.0;
+
+    // Spelniony warunek wczesnego zakonczenia (np. pierwsze trafienie w klocek)
+    bool finished = stopRequested;
+
+    // Uspienie pocisku, jesli jest podparty i jego energia kinetyczna
+    // utrzymuje sie ponizej progu przez caly przedzial czasu
+    if (!finished) {
+        float specificKinetic = (float)(0.5 * p.vel.dot(p.vel));
+        if (supported && specificKinetic < restEnergyThreshold) p.restTimer += dt;
+        else p.restTimer = 0.0f;
 
-    // Zatrzymanie ruchu, jeśli prędkość spadnie poniżej progu i pilka jest na ziemi
-    if (isRunning && proj.vel.length() < 0.2f && proj.pos.y < 1.0f) {
-        proj.vel = { 0,0,0 }; // Ustaw prędkość na zero
+        if (p.restTimer >= restTimeWindow) {
+            if (recordEnergy) stepDamping += kineticEnergy(p.vel); // reszta energii gasnie przy uspieniu
+            p.vel = { 0,0,0 }; // Ustaw prędkość na zero
+            p.sleeping = true;
+            finished = true;
+        }
+    }
+
+    // Bilans po uspieniu, zeby statystyki pokazywaly predkosc juz wyzerowana
+    if (recordEnergy) {
+        double energyAfter = mechanicalEnergy(p);
+        stepRestitution = energyBeforeContacts - energyAfterContacts;
+        double drift = energyAfter - (energyBefore - stepDrag - stepDamping - stepRestitution);
+
+        energyStats.lostDrag += stepDrag;
+        energyStats.lostDamping += stepDamping;
+        energyStats.lostRestitution += stepRestitution;
+        energyStats.totalDrift += drift;
+        energyStats.maxStepDrift = std::max(energyStats.maxStepDrift, std::abs(drift));
+        energyStats.kinetic = kineticEnergy(p.vel);
+        energyStats.potential = energyAfter - energyStats.kinetic;
+        energyStats.steps++;
+    }
+    return finished;
+}
+
+void update(float dt) {
+    if (!isRunning || proj.sleeping) return;
+    simTime += dt;
+    if (stepProjectile(proj, dt)) {
         isRunning = false;  // Zatrzymuje symulację
     }
 }
@@ -329,8 +1817,92 @@ struct Vertex {
     glm::vec2 texCoords;
 };
 
+// Spakowany wierzcholek dla siatek w VBO: 16 B zamiast 32 B (Vertex).
+// Pozycja jako half-float (4. skladowa tylko wyrownuje), normalna zakodowana
+// oktaedrycznie w dwoch snorm16, UV jako unorm16 - wszystkie siatki maja UV w [0, 1]
+struct PackedVertex {
+    uint16_t position[4];
+    int16_t normal[2];
+    uint16_t texCoords[2];
+};
+
+// float -> half (IEEE 754 binary16), zaokraglenie do najblizszej; wartosci
+// podnormalne w half sa zerowane - dla wspolrzednych siatek bez znaczenia
+uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (uint16_t)((bits >> 16) & 0x8000);
+    int exponent = (int)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+    if (exponent <= 0) return sign;
+    if (exponent >= 31) return (uint16_t)(sign | 0x7C00);
+    uint16_t half = (uint16_t)(sign | (exponent << 10) | (mantissa >> 13));
+    if (mantissa & 0x1000) half++; // zaokraglenie (przeniesienie do wykladnika jest poprawne)
+    return half;
+}
+
+// Kodowanie oktaedryczne: rzut normalnej na osmioscian |x|+|y|+|z| = 1 i rozlozenie na kwadrat
+glm::vec2 octEncode(glm::vec3 n) {
+    n /= (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    glm::vec2 e(n.x, n.y);
+    if (n.z < 0.0f) {
+        e = glm::vec2((1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f),
+                      (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+    }
+    return e;
+}
+
+PackedVertex packVertex(const glm::vec3& position, const glm::vec3& normal, const glm::vec2& texCoords) {
+    PackedVertex v;
+    v.position[0] = floatToHalf(position.x);
+    v.position[1] = floatToHalf(position.y);
+    v.position[2] = floatToHalf(position.z);
+    v.position[3] = floatToHalf(1.0f);
+    glm::vec2 oct = octEncode(normal);
+    v.normal[0] = (int16_t)std::lround(glm::clamp(oct.x, -1.0f, 1.0f) * 32767.0f);
+    v.normal[1] = (int16_t)std::lround(glm::clamp(oct.y, -1.0f, 1.0f) * 32767.0f);
+    v.texCoords[0] = (uint16_t)std::lround(glm::clamp(texCoords.x, 0.0f, 1.0f) * 65535.0f);
+    v.texCoords[1] = (uint16_t)std::lround(glm::clamp(texCoords.y, 0.0f, 1.0f) * 65535.0f);
+    return v;
+}
+
+// Atrybuty spakowanego wierzcholka dla aktualnie zbindowanego VAO/VBO
+void setupPackedVertexAttribs() {
+    // Pozycje (layout = 0)
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, position));
+    // Normalne (layout = 1) - dwie skladowe, dekodowane w shaderze (uOctNormals)
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, normal));
+    // Współrzędne teksturowe (layout = 2)
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (void*)offsetof(PackedVertex, texCoords));
+}
+
 std::vector<Vertex> sphereVertices;
 std::vector<unsigned int> sphereIndices; // Dodano indeksy
+GLenum sphereIndexType = GL_UNSIGNED_SHORT; // 16-bit, jesli liczba wierzcholkow na to pozwala
+size_t sphereIndexSize = sizeof(uint16_t);
+const GLsizei blockIndexCount = 36;
+
+// Poziomy szczegolowosci sfery - wszystkie w jednym VBO/EBO, wybierane
+// wedlug promienia kuli na ekranie w pikselach
+struct SphereLod {
+    int segments;
+    float minScreenRadius; // od tylu pikseli promienia uzywamy tego poziomu
+    GLsizei indexCount;
+    size_t indexOffset;    // przesuniecie w sphereIndices (w indeksach)
+};
+SphereLod sphereLods[] = {
+    { 4,  0.0f,  0, 0 }, // 32 trojkaty - odlegle punkty sladu
+    { 8,  4.0f,  0, 0 },
+    { 16, 12.0f, 0, 0 },
+    { 32, 40.0f, 0, 0 }  // pelna jakosc z bliska
+};
+const int SPHERE_LOD_COUNT = sizeof(sphereLods) / sizeof(sphereLods[0]);
+
+const float cameraFovY = glm::radians(45.0f);
+int framebufferHeight = 800; // aktualizowane co klatke, potrzebne do wyboru LOD
 
 // Wierzchołki dla standardowego sześcianu (1x1x1)
 const float cubeVerticesData[] = {
@@ -384,9 +1956,9 @@ const float cubeVerticesData[] = {
    -0.5f,  0.5f, -0.5f,  0.0f,  1.0f,  0.0f,  0.0f, 1.0f
 };
 
+// Dopisuje sfere o danej liczbie segmentow na koniec sphereVertices/sphereIndices
 void generateSphereData(float radius, int segments) {
-    sphereVertices.clear();
-    sphereIndices.clear();
+    unsigned int baseVertex = (unsigned int)sphereVertices.size();
 
     for (int y = 0; y <= segments; ++y) {
         for (int x = 0; x <= segments; ++x) {
@@ -408,8 +1980,8 @@ void generateSphereData(float radius, int segments) {
     // Generowanie indeksów dla pasków trójkątów (Triangle Strips)
     for (int y = 0; y < segments; ++y) {
         for (int x = 0; x < segments; ++x) {
-            int currentVertex = y * (segments + 1) + x;
-            int nextRowVertex = (y + 1) * (segments + 1) + x;
+            unsigned int currentVertex = baseVertex + y * (segments + 1) + x;
+            unsigned int nextRowVertex = baseVertex + (y + 1) * (segments + 1) + x;
 
             // Pierwszy trójkąt w kwadracie
             sphereIndices.push_back(currentVertex);
@@ -426,7 +1998,13 @@ void generateSphereData(float radius, int segments) {
 
 
 void initSphereVAO() {
-    generateSphereData(0.5f, 32); // Zwiększono segmenty dla płynniejszej sfery
+    sphereVertices.clear();
+    sphereIndices.clear();
+    for (auto& lod : sphereLods) {
+        lod.indexOffset = sphereIndices.size();
+        generateSphereData(0.5f, lod.segments);
+        lod.indexCount = (GLsizei)(sphereIndices.size() - lod.indexOffset);
+    }
 
     glGenVertexArrays(1, &vaoSphere);
     glGenBuffers(1, &vboSphere);
@@ -434,109 +2012,376 @@ void initSphereVAO() {
 
     glBindVertexArray(vaoSphere);
 
+    std::vector<PackedVertex> packed;
+    packed.reserve(sphereVertices.size());
+    for (auto& v : sphereVertices) packed.push_back(packVertex(v.position, v.normal, v.texCoords));
+
     glBindBuffer(GL_ARRAY_BUFFER, vboSphere);
-    glBufferData(GL_ARRAY_BUFFER, sphereVertices.size() * sizeof(Vertex), sphereVertices.data(), GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, packed.size() * sizeof(PackedVertex), packed.data(), GL_STATIC_DRAW);
 
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboSphere); // Bindowanie EBO
-    glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.size() * sizeof(unsigned int), sphereIndices.data(), GL_STATIC_DRAW);
+    if (sphereVertices.size() <= 0xFFFF) {
+        std::vector<uint16_t> shortIndices(sphereIndices.begin(), sphereIndices.end());
+        sphereIndexType = GL_UNSIGNED_SHORT;
+        sphereIndexSize = sizeof(uint16_t);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shortIndices.size() * sizeof(uint16_t), shortIndices.data(), GL_STATIC_DRAW);
+    }
+    else {
+        sphereIndexType = GL_UNSIGNED_INT;
+        sphereIndexSize = sizeof(unsigned int);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, sphereIndices.size() * sizeof(unsigned int), sphereIndices.data(), GL_STATIC_DRAW);
+    }
 
-    // Pozycje (layout = 0)
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
-    // Normalne (layout = 1)
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    // Współrzędne teksturowe (layout = 2)
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, texCoords));
+    setupPackedVertexAttribs();
 
     glBindVertexArray(0); // Odwiązanie VAO
 }
 
 // funkcja do inicjalizacji VAO dla klocka
+// 36 wierzcholkow z cubeVerticesData jest sklejanych w 24 unikalne + 36 indeksow 16-bit
 void initBlockVAO() {
+    std::vector<PackedVertex> vertices;
+    std::vector<uint16_t> indices;
+    for (int i = 0; i < blockIndexCount; ++i) {
+        const float* v = cubeVerticesData + i * 8;
+        PackedVertex pv = packVertex(glm::vec3(v[0], v[1], v[2]), glm::vec3(v[3], v[4], v[5]), glm::vec2(v[6], v[7]));
+        size_t found = 0;
+        while (found < vertices.size() && std::memcmp(&vertices[found], &pv, sizeof(PackedVertex)) != 0) ++found;
+        if (found == vertices.size()) vertices.push_back(pv);
+        indices.push_back((uint16_t)found);
+    }
+
     glGenVertexArrays(1, &vaoBlock);
     glGenBuffers(1, &vboBlock);
+    glGenBuffers(1, &eboBlock);
 
     glBindVertexArray(vaoBlock);
     glBindBuffer(GL_ARRAY_BUFFER, vboBlock);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(cubeVerticesData), cubeVerticesData, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(PackedVertex), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboBlock);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint16_t), indices.data(), GL_STATIC_DRAW);
 
-    // Pozycje (layout = 0)
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // Normalne (layout = 1)
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // Współrzędne teksturowe (layout = 2)
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
-    glEnableVertexAttribArray(2);
+    setupPackedVertexAttribs();
 
     glBindVertexArray(0);
-}
 
+    // Ta sama siatka z atrybutem instancji - indeksem klocka (wartosci zmieniane co klatke)
+    glGenVertexArrays(1, &vaoBlockInstanced);
+    glGenBuffers(1, &vboBlockInstances);
+    glBindVertexArray(vaoBlockInstanced);
+    glBindBuffer(GL_ARRAY_BUFFER, vboBlock);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboBlock);
+    setupPackedVertexAttribs();
+    glBindBuffer(GL_ARRAY_BUFFER, vboBlockInstances);
+    glEnableVertexAttribArray(3);
+    glVertexAttribIPointer(3, 1, GL_INT, sizeof(int32_t), (void*)0);
+    glVertexAttribDivisor(3, 1);
+    glBindVertexArray(0);
+
+    // Dane klockow w buforze tekstury; GL_MAX_TEXTURE_BUFFER_SIZE to na desktopie
+    // zwykle >= 2^27 tekseli, czyli dziesiatki milionow klockow
+    glGenBuffers(1, &tboBlockData);
+    glGenTextures(1, &texBlockData);
+    glBindBuffer(GL_TEXTURE_BUFFER, tboBlockData);
+    glBindTexture(GL_TEXTURE_BUFFER, texBlockData);
+    glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, tboBlockData);
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
 
-// Funkcja ładowania tekstury, zwracająca jej ID
-GLuint loadTexture(const char* path) {
-    GLuint texID;
-    glGenTextures(1, &texID);
-    glBindTexture(GL_TEXTURE_2D, texID);
 
+// Tablica GL_TEXTURE_2D_ARRAY z samym poziomem 0 (mipmapy po wyslaniu warstw)
+GLuint createTextureArray(int width, int height, int layers, int levels) {
+    GLuint id;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, id);
     // Ustawienia wrappingu
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
     // Ustawienia filtrowania
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    for (int l = 0; l < levels; ++l) {
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, l, GL_RGBA8, std::max(1, width >> l), std::max(1, height >> l), layers, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    }
+    return id;
+}
 
-    int width, height, nrChannels;
-    unsigned char* data = stbi_load(path, &width, &height, &nrChannels, 0);
-    if (data) {
-        GLenum format = GL_RGB;
-        if (nrChannels == 4)
-            format = GL_RGBA;
-        else if (nrChannels == 3)
-            format = GL_RGB;
+// Poziomy mipmap na CPU: srednia z bloku 2x2 (przy nieparzystym rozmiarze
+// ostatnia kolumna / wiersz sa powtarzane)
+void buildMipChain(const unsigned char* base, int width, int height, int levels, std::vector<unsigned char>& out) {
+    out.resize(mipChainBytes(width, height, levels));
+    std::memcpy(out.data(), base, (size_t)width * height * 4);
+    size_t srcOffset = 0, dstOffset = (size_t)width * height * 4;
+    int srcW = width, srcH = height;
+    for (int l = 1; l < levels; ++l) {
+        int dstW = std::max(1, width >> l), dstH = std::max(1, height >> l);
+        const unsigned char* src = out.data() + srcOffset;
+        unsigned char* dst = out.data() + dstOffset;
+        for (int y = 0; y < dstH; ++y) {
+            int y0 = std::min(2 * y, srcH - 1), y1 = std::min(2 * y + 1, srcH - 1);
+            for (int x = 0; x < dstW; ++x) {
+                int x0 = std::min(2 * x, srcW - 1), x1 = std::min(2 * x + 1, srcW - 1);
+                for (int c = 0; c < 4; ++c) {
+                    int sum = src[((size_t)y0 * srcW + x0) * 4 + c] + src[((size_t)y0 * srcW + x1) * 4 + c]
+                            + src[((size_t)y1 * srcW + x0) * 4 + c] + src[((size_t)y1 * srcW + x1) * 4 + c];
+                    dst[((size_t)y * dstW + x) * 4 + c] = (unsigned char)((sum + 2) / 4);
+                }
+            }
+        }
+        srcOffset = dstOffset;
+        dstOffset += (size_t)dstW * dstH * 4;
+        srcW = dstW;
+        srcH = dstH;
+    }
+}
 
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+// Rozmiary czytamy z naglowkow (stbi_info_from_memory na zmapowanym pliku, bez
+// dekodowania), wiec tablice mozna przydzielic od razu; dekodowanie idzie na watki
+// robocze i korzysta z tego samego mapowania
+void TextureManager::startLoading() {
+    const unsigned char checker[16] = { 160,160,160,255, 96,96,96,255, 96,96,96,255, 160,160,160,255 };
+    if (useTextureCache) makeDirectory(textureCacheDir);
+    TextureArray placeholderArray;
+    placeholderArray.width = placeholderArray.height = 2;
+    placeholderArray.layers = 1;
+    placeholderArray.id = createTextureArray(2, 2, 1, mipLevelCount(2, 2));
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, 0, 2, 2, 1, GL_RGBA, GL_UNSIGNED_BYTE, checker);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    placeholder = { (int)arrays.size(), 0, TEXTURE_READY };
+    arrays.push_back(placeholderArray);
+
+    size_t firstNewArray = arrays.size();
+    sources.resize(paths.size());
+    for (size_t h = 0; h < paths.size(); ++h) {
+        if (slots[h].state != TEXTURE_PENDING) continue;
+        int width = 0, height = 0, nrChannels = 0;
+        try {
+            sources[h].reset(new AssetView(paths[h].c_str()));
+        }
+        catch (const AssetError&) {
+        }
+        if (!sources[h] || !stbi_info_from_memory(sources[h]->data(), (int)sources[h]->size(), &width, &height, &nrChannels)) {
+            std::cerr << "Failed to load texture: " << paths[h] << std::endl;
+            slots[h].state = TEXTURE_FAILED;
+            sources[h].reset();
+            continue;
+        }
+        size_t a = firstNewArray;
+        while (a < arrays.size() && (arrays[a].width != width || arrays[a].height != height)) ++a;
+        if (a == arrays.size()) {
+            TextureArray arr;
+            arr.width = width;
+            arr.height = height;
+            arrays.push_back(arr);
+        }
+        slots[h].array = (int)a;
+        slots[h].layer = arrays[a].layers++;
+        decodeQueue.push_back((TextureHandle)h);
     }
-    else {
-        std::cerr << "Failed to load texture: " << path << std::endl;
-        // W przypadku niepowodzenia, zwróć 0 (nieprawidłowe ID tekstury)
-        glBindTexture(GL_TEXTURE_2D, 0); // Odwiąż wadliwą teksturę
-        glDeleteTextures(1, &texID); // Usuń wygenerowane ID
-        return 0;
+    for (size_t a = firstNewArray; a < arrays.size(); ++a) {
+        arrays[a].id = createTextureArray(arrays[a].width, arrays[a].height, arrays[a].layers, mipLevelCount(arrays[a].width, arrays[a].height));
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    glGenBuffers(1, &pbo);
+    pendingCount = (int)decodeQueue.size();
+
+    unsigned hw = std::thread::hardware_concurrency();
+    size_t threadCount = std::min<size_t>(decodeQueue.size(), hw > 1 ? hw - 1 : 1);
+    for (size_t t = 0; t < threadCount; ++t) {
+        workers.emplace_back([this]() {
+            for (;;) {
+                size_t i = nextDecode.fetch_add(1);
+                if (i >= decodeQueue.size()) break;
+                DecodedTexture d;
+                d.handle = decodeQueue[i];
+                prepare(d);
+                std::lock_guard<std::mutex> lock(readyMutex);
+                ready.push_back(std::move(d));
+            }
+        });
     }
-    stbi_image_free(data);
-    return texID;
 }
 
+// Watek roboczy: plik z cache, jesli pasuje do zrodla, w przeciwnym razie
+// dekodowanie JPG, mipmapy na CPU i zapis nowego wpisu cache
+void TextureManager::prepare(DecodedTexture& d) const {
+    if (!sources[d.handle]) return; // d.data == nullptr - pump() zglosi blad i oznaczy slot
+    const AssetView& source = *sources[d.handle];
+    uint64_t sourceHash = fnv1a(source.data(), source.size());
+
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", (unsigned long long)sourceHash);
+    std::string cachePath = std::string(textureCacheDir) + "/" + name + ".rztex";
+
+    if (useTextureCache) {
+        std::unique_ptr<MappedFile> cached(new MappedFile());
+        if (cached->open(cachePath.c_str()) && cached->size() >= sizeof(TextureCacheHeader)) {
+            TextureCacheHeader header;
+            std::memcpy(&header, cached->data(), sizeof(header));
+            bool ok = std::memcmp(header.magic, "RZTX", 4) == 0 && header.version == TEXTURE_CACHE_VERSION
+                && header.sourceHash == sourceHash && header.levels >= 1 && header.levels <= 32
+                && cached->size() == sizeof(header) + mipChainBytes(header.width, header.height, header.levels);
+            if (ok) {
+                d.width = (int)header.width;
+                d.height = (int)header.height;
+                d.levels = (int)header.levels;
+                d.data = cached->data() + sizeof(header);
+                d.mapped = std::move(cached);
+                return;
+            }
+        }
+    }
 
-// funkcja renderująca obiekty
-void renderObject(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj_mat, const glm::vec4& color, GLuint currentTextureID, bool textured, bool applyLighting, GLuint vao, GLsizei elementCount, GLenum mode = GL_TRIANGLES) {
-    glUseProgram(shaderProgram);
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uProjection"), 1, GL_FALSE, glm::value_ptr(proj_mat));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uView"), 1, GL_FALSE, glm::value_ptr(view));
-    glUniformMatrix4fv(glGetUniformLocation(shaderProgram, "uModel"), 1, GL_FALSE, glm::value_ptr(model));
-    glUniform3fv(glGetUniformLocation(shaderProgram, "viewPos"), 1, glm::value_ptr(cameraPos)); // Dodano pozycję kamery dla oświetlenia
+    int width, height, nrChannels;
+    unsigned char* image = stbi_load_from_memory(source.data(), (int)source.size(), &width, &height, &nrChannels, 4);
+    if (!image) return;
+    d.width = width;
+    d.height = height;
+    d.levels = mipLevelCount(width, height);
+    buildMipChain(image, width, height, d.levels, d.pixels);
+    stbi_image_free(image);
+    d.data = d.pixels.data();
+
+    if (useTextureCache) {
+        // Zapis do pliku tymczasowego i zmiana nazwy - inny proces nie zobaczy polowy pliku
+        TextureCacheHeader header;
+        std::memcpy(header.magic, "RZTX", 4);
+        header.version = TEXTURE_CACHE_VERSION;
+        header.sourceHash = sourceHash;
+        header.width = (uint32_t)width;
+        header.height = (uint32_t)height;
+        header.levels = (uint32_t)d.levels;
+        header.reserved = 0;
+        std::string tmpPath = cachePath + "." + std::to_string(d.handle) + ".tmp";
+        {
+            std::ofstream out(tmpPath, std::ios::binary);
+            out.write((const char*)&header, sizeof(header));
+            out.write((const char*)d.pixels.data(), (std::streamsize)d.pixels.size());
+        }
+        if (std::rename(tmpPath.c_str(), cachePath.c_str()) != 0) std::remove(tmpPath.c_str());
+    }
+}
+
+// Wysyla przygotowane obrazki (wszystkie poziomy mipmap) pasami wierszy przez PBO,
+// najwyzej byteBudget bajtow (co najmniej jeden wiersz) na wywolanie.
+// Zwraca true, jesli jakis slot zmienil stan.
+bool TextureManager::pump(size_t byteBudget) {
+    bool changed = false;
+    size_t spent = 0;
+    while (pendingCount > 0 && spent < byteBudget) {
+        if (uploading.handle == NO_TEXTURE) {
+            {
+                std::lock_guard<std::mutex> lock(readyMutex);
+                if (ready.empty()) break;
+                uploading = std::move(ready.front());
+                ready.pop_front();
+            }
+            sources[uploading.handle].reset(); // zdekodowane (albo z cache) - plik zrodlowy niepotrzebny
+            uploadLevel = 0;
+            uploadLevelOffset = 0;
+            uploadedRows = 0;
+            const TextureArray& arr = arrays[slots[uploading.handle].array];
+            if (!uploading.data || uploading.width != arr.width || uploading.height != arr.height
+                || uploading.levels != mipLevelCount(arr.width, arr.height)) {
+                std::cerr << "Failed to load texture: " << paths[uploading.handle] << std::endl;
+                slots[uploading.handle].state = TEXTURE_FAILED;
+                uploading = DecodedTexture();
+                pendingCount--;
+                changed = true;
+                continue;
+            }
+        }
+
+        const TextureSlot& slot = slots[uploading.handle];
+        int levelW = std::max(1, uploading.width >> uploadLevel);
+        int levelH = std::max(1, uploading.height >> uploadLevel);
+        size_t rowBytes = (size_t)levelW * 4;
+        size_t rows = std::max<size_t>(1, (byteBudget - spent) / rowBytes);
+        rows = std::min(rows, (size_t)(levelH - uploadedRows));
+        size_t bytes = rows * rowBytes;
+
+        // Osierocenie bufora - nie czekamy, az GPU skonczy kopiowac poprzedni pas
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+        void* dst = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+        if (dst) {
+            std::memcpy(dst, uploading.data + uploadLevelOffset + uploadedRows * rowBytes, bytes);
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, arrays[slot.array].id);
+            glTexSubImage3D(GL_TEXTURE_2D_ARRAY, uploadLevel, 0, uploadedRows, slot.layer, levelW, (GLsizei)rows, 1, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+        }
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        uploadedRows += (int)rows;
+        spent += bytes;
+
+        if (uploadedRows == levelH) {
+            uploadLevelOffset += (size_t)levelH * rowBytes;
+            uploadedRows = 0;
+            if (++uploadLevel == uploading.levels) {
+                slots[uploading.handle].state = TEXTURE_READY;
+                uploading = DecodedTexture(); // zwalnia piksele albo mapowanie cache
+                pendingCount--;
+                changed = true;
+            }
+        }
+    }
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+    if (pendingCount == 0 && !workers.empty()) shutdown();
+    return changed;
+}
+
+// Zatrzymuje watki robocze i zwalnia niewyslane obrazki
+void TextureManager::shutdown() {
+    nextDecode.store(decodeQueue.size());
+    for (auto& w : workers) w.join();
+    workers.clear();
+    ready.clear();
+    uploading = DecodedTexture();
+    sources.clear();
+}
 
-    glUniform1i(glGetUniformLocation(shaderProgram, "useTexture"), textured ? 1 : 0);
-    glUniform1i(glGetUniformLocation(shaderProgram, "disableLighting"), applyLighting ? 0 : 1); // 0 = włącz oświetlenie, 1 = wyłącz oświetlenie
 
-    if (textured && currentTextureID != 0) { // Sprawdzamy, czy tekstura jest poprawna
+// Uniformy wspolne dla renderObject i rysowania instancjonowanego
+void setViewUniforms(const glm::mat4& view, const glm::mat4& proj_mat) {
+    glUseProgram(shaderProgram);
+    glUniformMatrix4fv(defaultUniforms.uProjection, 1, GL_FALSE, glm::value_ptr(proj_mat));
+    glUniformMatrix4fv(defaultUniforms.uView, 1, GL_FALSE, glm::value_ptr(view));
+    // Wszystko jest we wspolrzednych wzgledem kamery: kamera w zerze, swiatlo przesuniete
+    glm::vec3 lightRelative = cameraRelative(lightWorldPos.x, lightWorldPos.y, lightWorldPos.z);
+    glUniform3f(defaultUniforms.viewPos, 0.0f, 0.0f, 0.0f);
+    glUniform3fv(defaultUniforms.lightPos, 1, glm::value_ptr(lightRelative));
+}
+
+// funkcja renderująca obiekty
+void renderObject(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj_mat, const glm::vec4& color, TextureHandle texture, bool textured, bool applyLighting, GLuint vao, GLsizei elementCount, GLenum mode = GL_TRIANGLES, size_t firstIndex = 0) {
+    setViewUniforms(view, proj_mat);
+    glUniformMatrix4fv(defaultUniforms.uModel, 1, GL_FALSE, glm::value_ptr(model));
+    glUniform1i(defaultUniforms.uInstanced, 0);
+
+    bool hasTexture = textured && textureManager.valid(texture); // Sprawdzamy, czy tekstura jest poprawna
+    glUniform1i(defaultUniforms.useTexture, hasTexture ? 1 : 0);
+    glUniform1i(defaultUniforms.disableLighting, applyLighting ? 0 : 1); // 0 = włącz oświetlenie, 1 = wyłącz oświetlenie
+    bool packedVertices = vao == vaoSphere || vao == vaoBlock; // ziemia zostaje we float (UV > 1)
+    glUniform1i(defaultUniforms.uOctNormals, packedVertices ? 1 : 0);
+
+    if (hasTexture) {
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, currentTextureID);
-        glUniform1i(glGetUniformLocation(shaderProgram, "uTexture"), 0);
+        const TextureSlot& slot = textureManager.resolve(texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, textureManager.arrayID(slot));
+        glUniform1f(defaultUniforms.uTextureLayer, (float)slot.layer);
     }
     else {
-        glBindTexture(GL_TEXTURE_2D, 0); // Jawnie odwiąż teksturę
-        glUniform4fv(glGetUniformLocation(shaderProgram, "uColor"), 1, glm::value_ptr(color));
+        glUniform4fv(defaultUniforms.uColor, 1, glm::value_ptr(color));
     }
 
     glBindVertexArray(vao);
     if (vao == vaoSphere) {
-        glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, elementCount, sphereIndexType, (void*)(firstIndex * sphereIndexSize));
+    }
+    else if (vao == vaoBlock) {
+        glDrawElements(GL_TRIANGLES, elementCount, GL_UNSIGNED_SHORT, 0);
     }
     else {
         glDrawArrays(mode, 0, elementCount);
@@ -544,25 +2389,66 @@ void renderObject(const glm::mat4& model, const glm::mat4& view, const glm::mat4
 }
 
 // Funkcje pomocnicze do renderowania konkretnych obiektów
-// Zaktualizowano parametry dla renderSphere i renderBlock
-void renderSphere(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj_mat, const glm::vec4& color, GLuint currentTextureID, bool textured = false, bool applyLighting = true) {
-    renderObject(model, view, proj_mat, color, currentTextureID, textured, applyLighting, vaoSphere, sphereIndices.size(), GL_TRIANGLES);
+// Zaktualizowano parametry dla renderSphere
+void renderSphere(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj_mat, const glm::vec4& color, TextureHandle texture, bool textured = false, bool applyLighting = true, int lod = SPHERE_LOD_COUNT - 1) {
+    const SphereLod& l = sphereLods[lod];
+    renderObject(model, view, proj_mat, color, texture, textured, applyLighting, vaoSphere, l.indexCount, GL_TRIANGLES, l.indexOffset);
+}
+
+// Wybor LOD z promienia na ekranie: r_px = r / odleglosc * (wysokosc / 2) / tan(fov / 2)
+// center jest we wspolrzednych wzgledem kamery
+int selectSphereLod(const glm::vec3& center, float radius) {
+    float distance = std::max(glm::length(center), 0.001f);
+    float screenRadius = radius / distance * (framebufferHeight * 0.5f) / std::tan(cameraFovY * 0.5f);
+    int lod = 0;
+    while (lod + 1 < SPHERE_LOD_COUNT && screenRadius >= sphereLods[lod + 1].minScreenRadius) ++lod;
+    return lod;
 }
 
-void renderBlock(const glm::mat4& model, const glm::mat4& view, const glm::mat4& proj_mat, const glm::vec4& color, GLuint currentTextureID, bool textured = false, bool applyLighting = true) {
-    renderObject(model, view, proj_mat, color, currentTextureID, textured, applyLighting, vaoBlock, 36); // Klocek ma 36 wierzchołków
+// Macierz modelu klocka (obrot i skala) bez przesuniecia
+glm::mat4 blockLinearMatrix(const Block& block) {
+    glm::mat4 model(1.0f);
+    if (block.rotated) {
+        // glm jest kolumnowy, Mat3 wierszowy
+        const Mat3& o = block.orientation;
+        model = glm::mat4(
+            o.r[0].x, o.r[1].x, o.r[2].x, 0.0f,
+            o.r[0].y, o.r[1].y, o.r[2].y, 0.0f,
+            o.r[0].z, o.r[1].z, o.r[2].z, 0.0f,
+            0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    return glm::scale(model, glm::vec3(block.size.x, block.size.y, block.size.z)); // Skalowanie klocka
 }
 
+// Dane instancji wysylane tylko po zmianie klockow. Przesuniecie jest wzgledem kotwicy
+// zbioru (liczone w double), shader dodaje do niego uInstanceOrigin = kotwica - kamera,
+// tez z double na CPU - na GPU nie ma odejmowania duzych liczb we float
+void uploadBlockInstanceData(const Block* first, size_t count, GLuint buffer, const glm::dvec3& anchor) {
+    std::vector<glm::vec4> data(count * 4);
+    for (size_t i = 0; i < count; ++i) {
+        const Block& block = first[i];
+        glm::mat4 linear = blockLinearMatrix(block);
+        data[i * 4 + 0] = linear[0];
+        data[i * 4 + 1] = linear[1];
+        data[i * 4 + 2] = linear[2];
+        float layer = textureManager.valid(block.texture) ? (float)textureManager.resolve(block.texture).layer : 0.0f;
+        glm::vec3 offset = glm::vec3(glm::dvec3(block.pos.x, block.pos.y, block.pos.z) - anchor);
+        data[i * 4 + 3] = glm::vec4(offset, layer);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, buffer);
+    glBufferData(GL_TEXTURE_BUFFER, data.size() * sizeof(glm::vec4), data.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
 
-void renderGround() {
+void renderGround(const glm::mat4& view, const glm::mat4& projection) {
     if (!vaoGround) {
         // Wierzchołki dla płaszczyzny, teraz z normalnymi i UV
         float groundVertices[] = {
             // Pozycje            // Normalne         // TexCoords (dostosowane do pokrycia większego obszaru)
-            -200.0f, 0.0f, -200.0f,  0.0f, 1.0f, 0.0f,  0.0f, 200.0f,
-             200.0f, 0.0f, -200.0f,  0.0f, 1.0f, 0.0f,  200.0f, 200.0f,
-             200.0f, 0.0f,  200.0f,  0.0f, 1.0f, 0.0f,  200.0f, 0.0f,
-            -200.0f, 0.0f,  200.0f,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f
+            -groundHalfSize, 0.0f, -groundHalfSize,  0.0f, 1.0f, 0.0f,  0.0f, 200.0f,
+             groundHalfSize, 0.0f, -groundHalfSize,  0.0f, 1.0f, 0.0f,  200.0f, 200.0f,
+             groundHalfSize, 0.0f,  groundHalfSize,  0.0f, 1.0f, 0.0f,  200.0f, 0.0f,
+            -groundHalfSize, 0.0f,  groundHalfSize,  0.0f, 1.0f, 0.0f,  0.0f, 0.0f
         };
         glGenVertexArrays(1, &vaoGround);
         glBindVertexArray(vaoGround);
@@ -583,10 +2469,354 @@ void renderGround() {
         glBindVertexArray(0);
     }
 
-    glm::mat4 model = glm::mat4(1.0f);
+    // Ziemia idzie za kamera, przesuwana o pelne okresy tekstury, zeby wzor stal w miejscu
+    double groundX = std::floor(cameraPos.x / groundTexturePeriod) * groundTexturePeriod;
+    double groundZ = std::floor(cameraPos.z / groundTexturePeriod) * groundTexturePeriod;
+    glm::mat4 model = glm::translate(glm::mat4(1.0f), cameraRelative(groundX, 0.0, groundZ));
     // Ziemia z teksturą i oświetleniem
     // Przekazujemy 0 dla uColor, bo i tak będzie użyta tekstura
-    renderObject(model, glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp), glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f), glm::vec4(0.0f), textures["textures/placeholder_ground.jpg"], true, true, vaoGround, 4, GL_TRIANGLE_FAN);
+    renderObject(model, view, projection, glm::vec4(0.0f), textureGround, true, true, vaoGround, 4, GL_TRIANGLE_FAN);
+}
+
+// Ostroslup widzenia: 6 plaszczyzn w ukladzie SoA, dopelnione do 8 plaszczyznami
+// zawsze przepuszczajacymi, zeby test kuli to dwa przebiegi po 4 plaszczyzny (SSE)
+struct Frustum {
+    alignas(16) float nx[8];
+    alignas(16) float ny[8];
+    alignas(16) float nz[8];
+    alignas(16) float d[8];
+};
+
+bool frustumCulling = true;
+int culledDraws = 0; // ile obiektow pominieto w ostatniej klatce
+
+// Plaszczyzny z macierzy rzut * widok (metoda Gribba-Hartmanna), znormalizowane,
+// wiec odleglosc od plaszczyzny jest w metrach i mozna ja porownac z promieniem
+Frustum extractFrustum(const glm::mat4& viewProj) {
+    Frustum f;
+    glm::vec4 row0(viewProj[0][0], viewProj[1][0], viewProj[2][0], viewProj[3][0]);
+    glm::vec4 row1(viewProj[0][1], viewProj[1][1], viewProj[2][1], viewProj[3][1]);
+    glm::vec4 row2(viewProj[0][2], viewProj[1][2], viewProj[2][2], viewProj[3][2]);
+    glm::vec4 row3(viewProj[0][3], viewProj[1][3], viewProj[2][3], viewProj[3][3]);
+    glm::vec4 planes[6] = { row3 + row0, row3 - row0, row3 + row1, row3 - row1, row3 + row2, row3 - row2 };
+    for (int i = 0; i < 8; ++i) {
+        if (i < 6) {
+            glm::vec4 pl = planes[i] / glm::length(glm::vec3(planes[i]));
+            f.nx[i] = pl.x; f.ny[i] = pl.y; f.nz[i] = pl.z; f.d[i] = pl.w;
+        }
+        else {
+            f.nx[i] = 0.0f; f.ny[i] = 0.0f; f.nz[i] = 0.0f; f.d[i] = 1e30f;
+        }
+    }
+    return f;
+}
+
+// Kula jest niewidoczna, jesli lezy cala po zewnetrznej stronie ktorejkolwiek plaszczyzny
+bool sphereInFrustum(const Frustum& f, const glm::vec3& center, float radius) {
+#ifdef RZUT_HAS_SSE
+    __m128 cx = _mm_set1_ps(center.x), cy = _mm_set1_ps(center.y), cz = _mm_set1_ps(center.z);
+    __m128 negR = _mm_set1_ps(-radius);
+    for (int i = 0; i < 8; i += 4) {
+        __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(f.nx + i), cx), _mm_mul_ps(_mm_load_ps(f.ny + i), cy)),
+                                 _mm_add_ps(_mm_mul_ps(_mm_load_ps(f.nz + i), cz), _mm_load_ps(f.d + i)));
+        if (_mm_movemask_ps(_mm_cmplt_ps(dist, negR)) != 0) return false;
+    }
+    return true;
+#else
+    for (int i = 0; i < 6; ++i) {
+        if (f.nx[i] * center.x + f.ny[i] * center.y + f.nz[i] * center.z + f.d[i] < -radius) return false;
+    }
+    return true;
+#endif
+}
+
+// Test z liczeniem pominietych obiektow
+bool isVisible(const Frustum& f, const glm::vec3& center, float radius) {
+    if (!frustumCulling || sphereInFrustum(f, center, radius)) return true;
+    culledDraws++;
+    return false;
+}
+
+// Widoczne klocki jednego zbioru (scena albo kafelek) jednym glDrawElementsInstanced
+// na tablice tekstur (+ jedno dla klockow bez tekstury). GL 3.3 nie ma baseInstance,
+// wiec grupy wybieramy przesuwajac offset atrybutu instancji. dataTexture - bufor
+// tekstury z danymi tego zbioru; uniformy ustawia renderBlocksInstanced
+void renderBlockSet(const Block* first, size_t count, GLuint dataTexture, const glm::dvec3& anchor, const Frustum& frustum) {
+    size_t groups = textureManager.arrays.size() + 1; // ostatnia grupa - bez tekstury
+    visibleBlockIndices.clear();
+    visibleBlockGroupStart.assign(groups + 1, 0);
+    // Dwa przebiegi: zliczenie na grupe, potem wpisanie indeksow na miejsce
+    std::vector<size_t>& start = visibleBlockGroupStart;
+    std::vector<uint8_t> visible(count, 0);
+    for (size_t i = 0; i < count; ++i) {
+        const Block& block = first[i];
+        glm::vec3 blockCenter = cameraRelative(block.pos.x, block.pos.y, block.pos.z);
+        // Kula opisana na klocku - dziala tez dla obroconych
+        if (!isVisible(frustum, blockCenter, 0.5f * block.size.length())) continue;
+        visible[i] = 1;
+        size_t group = textureManager.valid(block.texture) ? (size_t)textureManager.resolve(block.texture).array : groups - 1;
+        start[group + 1]++;
+    }
+    for (size_t g = 0; g < groups; ++g) start[g + 1] += start[g];
+    visibleBlockIndices.resize(start[groups]);
+    std::vector<size_t> cursor(start.begin(), start.end() - 1);
+    for (size_t i = 0; i < count; ++i) {
+        if (!visible[i]) continue;
+        size_t group = textureManager.valid(first[i].texture) ? (size_t)textureManager.resolve(first[i].texture).array : groups - 1;
+        visibleBlockIndices[cursor[group]++] = (int32_t)i;
+    }
+    if (visibleBlockIndices.empty()) return;
+    visibleBlockCount += (int)visibleBlockIndices.size();
+
+    // Osierocenie bufora - poprzedni zbior w tej klatce moze byc jeszcze rysowany
+    glBindBuffer(GL_ARRAY_BUFFER, vboBlockInstances);
+    glBufferData(GL_ARRAY_BUFFER, visibleBlockIndices.size() * sizeof(int32_t), visibleBlockIndices.data(), GL_STREAM_DRAW);
+    glm::vec3 origin = cameraRelative(anchor.x, anchor.y, anchor.z);
+    glUniform3fv(defaultUniforms.uInstanceOrigin, 1, glm::value_ptr(origin));
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, dataTexture);
+
+    glBindVertexArray(vaoBlockInstanced);
+    for (size_t g = 0; g < groups; ++g) {
+        GLsizei groupCount = (GLsizei)(start[g + 1] - start[g]);
+        if (groupCount == 0) continue;
+        bool textured = g + 1 < groups;
+        glUniform1i(defaultUniforms.useTexture, textured ? 1 : 0);
+        if (textured) {
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D_ARRAY, textureManager.arrays[g].id);
+        }
+        glVertexAttribIPointer(3, 1, GL_INT, sizeof(int32_t), (void*)(start[g] * sizeof(int32_t)));
+        glDrawElementsInstanced(GL_TRIANGLES, blockIndexCount, GL_UNSIGNED_SHORT, 0, groupCount);
+        blockDrawCalls++;
+    }
+    glBindVertexArray(0);
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Klocki sceny i kafelkow swiata w pamieci; kafelek poza frustum odpada w calosci
+// po kuli opisanej na jego obrysie
+void renderBlocksInstanced(const glm::mat4& view, const glm::mat4& projection, const Frustum& frustum) {
+    if (blockInstanceDataDirty) {
+        // Kotwica sceny - srodek obrysu srodkow klockow
+        glm::dvec3 lo(0.0), hi(0.0);
+        for (size_t i = 0; i < blocks.size(); ++i) {
+            glm::dvec3 c(blocks[i].pos.x, blocks[i].pos.y, blocks[i].pos.z);
+            lo = i == 0 ? c : glm::min(lo, c);
+            hi = i == 0 ? c : glm::max(hi, c);
+        }
+        sceneInstanceAnchor = 0.5 * (lo + hi);
+        uploadBlockInstanceData(blocks.begin(), blocks.size(), tboBlockData, sceneInstanceAnchor);
+        for (auto& tile : world.resident) tile->gpuDirty = true;
+        blockInstanceDataDirty = false;
+    }
+
+    setViewUniforms(view, projection);
+    glUniform1i(defaultUniforms.uInstanced, 1);
+    glUniform1i(defaultUniforms.uOctNormals, 1);
+    glUniform1i(defaultUniforms.disableLighting, 0);
+    // Kolor bialy, aby tekstura byla widoczna
+    glUniform4f(defaultUniforms.uColor, 1.0f, 1.0f, 1.0f, 1.0f);
+
+    blockDrawCalls = 0;
+    visibleBlockCount = 0;
+    renderBlockSet(blocks.begin(), blocks.size(), texBlockData, sceneInstanceAnchor, frustum);
+    for (auto& tile : world.resident) {
+        if (tile->count == 0) continue;
+        Vec3 lo = tile->boundsMin, hi = tile->boundsMax;
+        glm::vec3 center = cameraRelative(0.5 * ((double)lo.x + hi.x), 0.5 * ((double)lo.y + hi.y), 0.5 * ((double)lo.z + hi.z));
+        if (!isVisible(frustum, center, 0.5f * (hi - lo).length())) continue;
+        if (!tile->gpuBuffer) {
+            std::pair<GLuint, GLuint> entry = tileBufferPool.acquire();
+            tile->gpuBuffer = entry.first;
+            tile->gpuTexture = entry.second;
+            tile->gpuDirty = true;
+        }
+        if (tile->gpuDirty) {
+            uploadBlockInstanceData(tile->blocks, tile->count, tile->gpuBuffer, worldTileOrigin(*tile));
+            tile->gpuDirty = false;
+        }
+        renderBlockSet(tile->blocks, tile->count, tile->gpuTexture, worldTileOrigin(*tile), frustum);
+    }
+}
+
+
+void initTrailPointsVAO() {
+    glGenVertexArrays(1, &vaoTrailPoints);
+    glGenBuffers(1, &vboTrailPoints);
+    glBindVertexArray(vaoTrailPoints);
+    glBindBuffer(GL_ARRAY_BUFFER, vboTrailPoints);
+    glBufferData(GL_ARRAY_BUFFER, trailPointsRing * sizeof(glm::vec3), nullptr, GL_DYNAMIC_DRAW);
+    // Srodek kuli wzgledem trailPointsOrigin (layout = 0)
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+    glBindVertexArray(0);
+}
+
+// Dopisuje do pierscienia punktow tylko punkty sladu, ktorych jeszcze w nim nie ma
+void syncTrailPoints() {
+    const auto& trail = proj.trail;
+    uint64_t fresh = proj.trailPushed - trailPointsSynced;
+    const Vec3& last = trail.back();
+    bool rebase = glm::length(glm::dvec3(last.x, last.y, last.z) - trailPointsOrigin) > trailOriginRebaseDistance;
+    if (proj.trailEpoch != trailPointsEpoch || fresh > trail.size() || rebase) {
+        // Nowy rzut, slad przycial niedopisane punkty albo pocisk odlecial daleko - od nowa
+        trailPointsEpoch = proj.trailEpoch;
+        trailPointsHead = 0;
+        trailPointsCount = 0;
+        fresh = trail.size();
+        trailPointsOrigin = glm::dvec3(last.x, last.y, last.z);
+    }
+    trailPointsScratch.clear();
+    for (size_t i = trail.size() - (size_t)fresh; i < trail.size(); i++) {
+        trailPointsScratch.push_back(glm::vec3(glm::dvec3(trail[i].x, trail[i].y, trail[i].z) - trailPointsOrigin));
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, vboTrailPoints);
+    size_t written = 0;
+    while (written < trailPointsScratch.size()) {
+        size_t n = std::min(trailPointsScratch.size() - written, trailPointsRing - trailPointsHead);
+        glBufferSubData(GL_ARRAY_BUFFER, trailPointsHead * sizeof(glm::vec3), n * sizeof(glm::vec3), trailPointsScratch.data() + written);
+        trailPointsHead = (trailPointsHead + n) % trailPointsRing;
+        written += n;
+    }
+    trailPointsCount = std::min(trailPointsCount + trailPointsScratch.size(), trailPointsRing);
+    trailPointsSynced = proj.trailPushed;
+}
+
+// Caly slad jednym (przy zawinieciu pierscienia - dwoma) glDrawArrays(GL_POINTS);
+// co klatke do VBO trafiaja tylko nowe punkty. Odrzucanie poza kamera robi GPU
+// (punkty poza ekranem sa przycinane)
+void renderTrailImpostors(const glm::mat4& view, const glm::mat4& projection) {
+    if (proj.trail.empty()) return;
+    syncTrailPoints();
+    size_t points = std::min(trailPointsCount, proj.trail.size());
+
+    glUseProgram(impostorProgram);
+    const ImpostorUniforms& u = impostorUniforms;
+    glUniformMatrix4fv(u.uProjection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(u.uView, 1, GL_FALSE, glm::value_ptr(view));
+    glUniformMatrix4fv(u.uInvProjection, 1, GL_FALSE, glm::value_ptr(glm::inverse(projection)));
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glUniform4f(u.uViewport, (float)viewport[0], (float)viewport[1], (float)viewport[2], (float)viewport[3]);
+    glUniform1f(u.uRadius, trailRadius);
+    glUniform4fv(u.uColor, 1, glm::value_ptr(trailColor));
+    glm::vec3 origin = cameraRelative(trailPointsOrigin.x, trailPointsOrigin.y, trailPointsOrigin.z);
+    glUniform3fv(u.uOrigin, 1, glm::value_ptr(origin));
+
+    glEnable(GL_PROGRAM_POINT_SIZE);
+    glBindVertexArray(vaoTrailPoints);
+    size_t first = (trailPointsHead + trailPointsRing - points) % trailPointsRing;
+    size_t tail = std::min(points, trailPointsRing - first);
+    glDrawArrays(GL_POINTS, (GLint)first, (GLsizei)tail);
+    if (tail < points) glDrawArrays(GL_POINTS, 0, (GLsizei)(points - tail));
+    glBindVertexArray(0);
+    glDisable(GL_PROGRAM_POINT_SIZE);
+}
+
+void initRibbon() {
+    glGenVertexArrays(1, &vaoRibbon);
+    glGenBuffers(1, &vboRibbon);
+    glBindVertexArray(vaoRibbon);
+    glBindBuffer(GL_ARRAY_BUFFER, vboRibbon);
+
+    if (glVersionAtLeast(4, 4) || hasGLExtension("GL_ARB_buffer_storage")) rzutBufferStorage = (PFNRZUTBUFFERSTORAGEPROC)glfwGetProcAddress("glBufferStorage");
+
+    GLsizeiptr bytes = (GLsizeiptr)(ribbonRingSegments * 6 * sizeof(RibbonVertex));
+    if (rzutBufferStorage) {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        rzutBufferStorage(GL_ARRAY_BUFFER, bytes, nullptr, flags);
+        ribbonMapped = (RibbonVertex*)glMapBufferRange(GL_ARRAY_BUFFER, 0, bytes, flags);
+    }
+    if (!ribbonMapped) {
+        // GL 3.3: zwykly bufor, nowe odcinki dopisywane przez glBufferSubData
+        glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_DYNAMIC_DRAW);
+    }
+
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RibbonVertex), (void*)offsetof(RibbonVertex, pos));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(RibbonVertex), (void*)offsetof(RibbonVertex, other));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 1, GL_FLOAT, GL_FALSE, sizeof(RibbonVertex), (void*)offsetof(RibbonVertex, side));
+    glBindVertexArray(0);
+}
+
+// Dopisuje jeden odcinek a -> b w miejscu ribbonHead
+void appendRibbonSegment(const Vec3& a, const Vec3& b) {
+    if (ribbonHead == 0 && ribbonCount > 0 && ribbonFence) {
+        // Pierscien sie zawinal - nie nadpisujemy danych, ktore GPU moze jeszcze czytac
+        glClientWaitSync(ribbonFence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000ull);
+        glDeleteSync(ribbonFence);
+        ribbonFence = 0;
+    }
+    glm::vec3 pa((float)(a.x - ribbonOrigin.x), (float)(a.y - ribbonOrigin.y), (float)(a.z - ribbonOrigin.z));
+    glm::vec3 pb((float)(b.x - ribbonOrigin.x), (float)(b.y - ribbonOrigin.y), (float)(b.z - ribbonOrigin.z));
+    // Wierzcholki koncowki b patrza w strone a, wiec ich strona ma odwrocony znak
+    RibbonVertex seg[6] = {
+        { pa, pb,  1.0f }, { pa, pb, -1.0f }, { pb, pa, -1.0f },
+        { pb, pa, -1.0f }, { pa, pb, -1.0f }, { pb, pa,  1.0f },
+    };
+    if (ribbonMapped) {
+        std::memcpy(ribbonMapped + ribbonHead * 6, seg, sizeof(seg));
+    }
+    else {
+        glBindBuffer(GL_ARRAY_BUFFER, vboRibbon);
+        glBufferSubData(GL_ARRAY_BUFFER, (GLintptr)(ribbonHead * sizeof(seg)), sizeof(seg), seg);
+    }
+    ribbonHead = (ribbonHead + 1) % ribbonRingSegments;
+    ribbonCount = std::min(ribbonCount + 1, ribbonRingSegments);
+}
+
+// Dopisuje do pierscienia tylko punkty sladu, ktorych wstega jeszcze nie ma
+void syncRibbon() {
+    const auto& trail = proj.trail;
+    uint64_t fresh = proj.trailPushed - ribbonSynced;
+    if (proj.trailEpoch != ribbonEpoch || trail.empty() || fresh > trail.size()) {
+        // Nowy rzut albo slad przycial punkty, ktorych nie zdazylismy dopisac - od nowa
+        ribbonEpoch = proj.trailEpoch;
+        ribbonCount = 0;
+        ribbonHasLast = false;
+        fresh = trail.size();
+        if (!trail.empty()) ribbonOrigin = glm::dvec3(trail.front().x, trail.front().y, trail.front().z);
+    }
+    for (size_t i = trail.size() - (size_t)fresh; i < trail.size(); i++) {
+        if (ribbonHasLast) appendRibbonSegment(ribbonLastPoint, trail[i]);
+        ribbonLastPoint = trail[i];
+        ribbonHasLast = true;
+    }
+    ribbonSynced = proj.trailPushed;
+}
+
+void renderTrailRibbon(const glm::mat4& view, const glm::mat4& projection) {
+    syncRibbon();
+    // Rysujemy tylko tyle ostatnich odcinkow, ile obejmuje obecny slad
+    size_t segments = proj.trail.size() > 1 ? std::min(ribbonCount, proj.trail.size() - 1) : 0;
+    if (segments == 0) return;
+
+    glUseProgram(ribbonProgram);
+    const RibbonUniforms& u = ribbonUniforms;
+    glUniformMatrix4fv(u.uProjection, 1, GL_FALSE, glm::value_ptr(projection));
+    glUniformMatrix4fv(u.uView, 1, GL_FALSE, glm::value_ptr(view));
+    glm::vec3 origin = cameraRelative(ribbonOrigin.x, ribbonOrigin.y, ribbonOrigin.z);
+    glUniform3fv(u.uOrigin, 1, glm::value_ptr(origin));
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    glUniform2f(u.uViewportSize, (float)viewport[2], (float)viewport[3]);
+    glUniform1f(u.uWidth, ribbonWidth);
+    glUniform4fv(u.uColor, 1, glm::value_ptr(trailColor));
+
+    glBindVertexArray(vaoRibbon);
+    size_t first = (ribbonHead + ribbonRingSegments - segments) % ribbonRingSegments;
+    size_t tail = std::min(segments, ribbonRingSegments - first);
+    glDrawArrays(GL_TRIANGLES, (GLint)(first * 6), (GLsizei)(tail * 6));
+    if (tail < segments) glDrawArrays(GL_TRIANGLES, 0, (GLsizei)((segments - tail) * 6));
+    glBindVertexArray(0);
+
+    if (ribbonMapped) {
+        if (ribbonFence) glDeleteSync(ribbonFence);
+        ribbonFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
 }
 
 void renderScene() {
@@ -595,24 +2825,25 @@ void renderScene() {
     glEnable(GL_DEPTH_TEST);
 
     // Renderujemy wszystkie obiekty nieprzezroczyste najpierw
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), 800.0f / 600.0f, 0.1f, 1000.0f);
-    glm::mat4 view = glm::lookAt(cameraPos, cameraPos + cameraFront, cameraUp);
+    glm::mat4 projection = glm::perspective(cameraFovY, 800.0f / 600.0f, 0.1f, 1000.0f);
+    // Widok z kamera w poczatku ukladu - pozycje obiektow sa juz wzgledem kamery
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), cameraFront, cameraUp);
+    Frustum frustum = extractFrustum(projection * view);
+    culledDraws = 0;
 
     // Renderujemy ziemię
-    renderGround();
+    renderGround(view, projection);
 
     // Renderujemy klocki (nieprzezroczyste)
-    for (auto& block : blocks) {
-        glm::mat4 modelBlock = glm::translate(glm::mat4(1.0f), glm::vec3(block.pos.x, block.pos.y, block.pos.z));
-        modelBlock = glm::scale(modelBlock, glm::vec3(block.size.x, block.size.y, block.size.z)); // Skalowanie klocka
-        // Używamy tekstury przypisanej do klocka, włączamy teksturowanie, włączamy oświetlenie
-        renderBlock(modelBlock, view, projection, glm::vec4(1.0f), block.textureID, true, true); // Kolor ustawiamy na biały, aby tekstura była widoczna
-    }
+    renderBlocksInstanced(view, projection, frustum);
 
     // Renderujemy pocisk (nieprzezroczysty, jeśli nie ma przezroczystości)
-    glm::mat4 modelProj = glm::translate(glm::mat4(1.0f), glm::vec3(proj.pos.x, proj.pos.y, proj.pos.z));
-    // Używamy textureIDProjectile, włączamy teksturowanie, włączamy oświetlenie
-    renderSphere(modelProj, view, projection, glm::vec4(1.0f), textureIDProjectile, true, true); // Kolor ustawiamy na biały
+    glm::vec3 projCenter = cameraRelative(proj.pos.x, proj.pos.y, proj.pos.z);
+    if (isVisible(frustum, projCenter, 0.5f)) {
+        glm::mat4 modelProj = glm::translate(glm::mat4(1.0f), projCenter);
+        // Używamy textureProjectile, włączamy teksturowanie, włączamy oświetlenie
+        renderSphere(modelProj, view, projection, glm::vec4(1.0f), textureProjectile, true, true, selectSphereLod(projCenter, 0.5f)); // Kolor ustawiamy na biały
+    }
 
     // Aktywacja blendingu dla przezroczystości
     glEnable(GL_BLEND);
@@ -621,10 +2852,20 @@ void renderScene() {
     glDepthMask(GL_FALSE);
 
     // Renderujemy ślad pocisku (przezroczysty)
-    for (auto& p : proj.trail) {
-        glm::mat4 trailModel = glm::translate(glm::mat4(1.0f), glm::vec3(p.x, p.y, p.z));
-        // Bez tekstury, wyłączone oświetlenie, przezroczystość
-        renderSphere(trailModel, view, projection, glm::vec4(1.0f, 0.8f, 0.2f, 0.5f), 0, false, false);
+    if (trailStyle == TRAIL_IMPOSTORS) {
+        renderTrailImpostors(view, projection);
+    }
+    else if (trailStyle == TRAIL_RIBBON) {
+        renderTrailRibbon(view, projection);
+    }
+    else {
+        for (auto& p : proj.trail) {
+            glm::vec3 trailCenter = cameraRelative(p.x, p.y, p.z);
+            if (!isVisible(frustum, trailCenter, trailRadius)) continue;
+            glm::mat4 trailModel = glm::translate(glm::mat4(1.0f), trailCenter);
+            // Bez tekstury, wyłączone oświetlenie, przezroczystość
+            renderSphere(trailModel, view, projection, trailColor, NO_TEXTURE, false, false, selectSphereLod(trailCenter, trailRadius));
+        }
     }
 
     // Przywróć zapis do bufora głębi
@@ -633,9 +2874,107 @@ void renderScene() {
     glDisable(GL_BLEND);
 }
 
-GLuint compileShader(GLenum type, const char* src) {
+// Cache zlinkowanych programow (glGetProgramBinary). Jeden plik na program (nazwa z
+// plikow shaderow), wiec kolejne edycje przy przeladowaniu nadpisuja ten sam wpis
+// zamiast dokladac nowe. Binarka jest wazna tylko dla tego samego sterownika, wiec
+// w naglowku jest hash zrodel shaderow i napisow GL_VENDOR / GL_RENDERER / GL_VERSION.
+// Nieaktualny wpis (np. po aktualizacji sterownika z tym samym napisem) konczy sie
+// bledem linkowania i zwykla kompilacja.
+struct ProgramCacheHeader {
+    char magic[4]; // "RZSH"
+    uint32_t version;
+    uint32_t binaryFormat;
+    uint32_t length;
+    uint64_t sourceHash;
+};
+const uint32_t PROGRAM_CACHE_VERSION = 2;
+bool useProgramCache = true;
+const char* programCacheDir = "shader_cache";
+uint64_t programCacheDriverHash = 0;
+
+void initProgramCache() {
+    if (!glVersionAtLeast(4, 1) && !hasGLExtension("GL_ARB_get_program_binary")) return;
+    rzutGetProgramBinary = (PFNRZUTGETPROGRAMBINARYPROC)glfwGetProcAddress("glGetProgramBinary");
+    rzutProgramBinary = (PFNRZUTPROGRAMBINARYPROC)glfwGetProcAddress("glProgramBinary");
+    rzutProgramParameteri = (PFNRZUTPROGRAMPARAMETERIPROC)glfwGetProcAddress("glProgramParameteri");
+    if (!rzutGetProgramBinary || !rzutProgramBinary || !rzutProgramParameteri) {
+        rzutGetProgramBinary = nullptr;
+        return;
+    }
+    const GLenum driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+    uint64_t hash = fnv1a("", 0);
+    for (GLenum name : driverStrings) {
+        const char* str = (const char*)glGetString(name);
+        if (str) hash = fnv1a(str, std::strlen(str) + 1, hash);
+    }
+    programCacheDriverHash = hash;
+    makeDirectory(programCacheDir);
+}
+
+bool programCacheEnabled() { return useProgramCache && rzutGetProgramBinary != nullptr; }
+
+uint64_t programSourceHash(const AssetView& vs, const AssetView& fs) {
+    uint64_t hash = fnv1a(vs.data(), vs.size(), programCacheDriverHash);
+    hash = fnv1a("\0", 1, hash); // separator - "ab" + "c" != "a" + "bc"
+    return fnv1a(fs.data(), fs.size(), hash);
+}
+
+std::string programCachePath(const char* name) {
+    std::string file = name;
+    for (char& c : file) {
+        if (c == '/' || c == '\\' || c == ':') c = '_';
+    }
+    return std::string(programCacheDir) + "/" + file + ".bin";
+}
+
+// 0 = brak wpisu albo sterownik go odrzucil
+GLuint loadCachedProgram(const std::string& path, uint64_t sourceHash) {
+    MappedFile cached;
+    if (!cached.open(path.c_str()) || cached.size() < sizeof(ProgramCacheHeader)) return 0;
+    ProgramCacheHeader header;
+    std::memcpy(&header, cached.data(), sizeof(header));
+    if (std::memcmp(header.magic, "RZSH", 4) != 0 || header.version != PROGRAM_CACHE_VERSION
+        || header.sourceHash != sourceHash || cached.size() != sizeof(header) + header.length) return 0;
+
+    GLuint prog = glCreateProgram();
+    rzutProgramBinary(prog, header.binaryFormat, cached.data() + sizeof(header), (GLsizei)header.length);
+    GLint success = 0;
+    glGetProgramiv(prog, GL_LINK_STATUS, &success);
+    if (!success) {
+        glDeleteProgram(prog);
+        return 0;
+    }
+    return prog;
+}
+
+void storeCachedProgram(const std::string& path, uint64_t sourceHash, GLuint prog) {
+    GLint length = 0;
+    glGetProgramiv(prog, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+    std::vector<unsigned char> binary((size_t)length);
+    GLenum format = 0;
+    rzutGetProgramBinary(prog, length, nullptr, &format, binary.data());
+
+    ProgramCacheHeader header = {};
+    std::memcpy(header.magic, "RZSH", 4);
+    header.sourceHash = sourceHash;
+    header.version = PROGRAM_CACHE_VERSION;
+    header.binaryFormat = format;
+    header.length = (uint32_t)length;
+    std::string tmpPath = path + ".tmp";
+    {
+        std::ofstream out(tmpPath, std::ios::binary);
+        out.write((const char*)&header, sizeof(header));
+        out.write((const char*)binary.data(), length);
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) std::remove(tmpPath.c_str());
+}
+
+GLuint compileShader(GLenum type, const AssetView& source) {
     GLuint shader = glCreateShader(type);
-    glShaderSource(shader, 1, &src, nullptr);
+    const char* src = source.chars();
+    GLint length = (GLint)source.size();
+    glShaderSource(shader, 1, &src, &length);
     glCompileShader(shader);
 
     GLint success;
@@ -648,15 +2987,23 @@ GLuint compileShader(GLenum type, const char* src) {
     return shader;
 }
 
-GLuint createShaderProgram() {
-	char* vs = get_file_contents("default.vert");
-    char* fs = get_file_contents("default.frag");
+// name - klucz wpisu w cache programow (jeden plik na nazwe)
+GLuint createShaderProgram(const char* name, const AssetView& vs, const AssetView& fs) {
+    std::string cachePath;
+    uint64_t sourceHash = 0;
+    if (programCacheEnabled()) {
+        cachePath = programCachePath(name);
+        sourceHash = programSourceHash(vs, fs);
+        GLuint cached = loadCachedProgram(cachePath, sourceHash);
+        if (cached) return cached;
+    }
 
     GLuint v = compileShader(GL_VERTEX_SHADER, vs);
     GLuint f = compileShader(GL_FRAGMENT_SHADER, fs);
     GLuint prog = glCreateProgram();
     glAttachShader(prog, v);
     glAttachShader(prog, f);
+    if (programCacheEnabled()) rzutProgramParameteri(prog, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
     glLinkProgram(prog);
 
     GLint success;
@@ -666,32 +3013,447 @@ GLuint createShaderProgram() {
         glGetProgramInfoLog(prog, 512, nullptr, infoLog);
         std::cerr << "Shader program linking error:\n" << infoLog << std::endl;
     }
+    else if (programCacheEnabled()) {
+        storeCachedProgram(cachePath, sourceHash, prog);
+    }
 
     glDeleteShader(v);
     glDeleteShader(f);
+    if (!success) {
+        glDeleteProgram(prog);
+        return 0;
+    }
     return prog;
 }
 
+// Zwraca 0, jesli odczyt plikow, kompilacja albo linkowanie sie nie udaly
+GLuint createShaderProgram(const char* vertPath = "default.vert", const char* fragPath = "default.frag") {
+    try {
+        AssetView vs(vertPath), fs(fragPath);
+        std::string name = std::string(vertPath) + "_" + fragPath;
+        return createShaderProgram(name.c_str(), vs, fs);
+    }
+    catch (const AssetError& e) {
+        std::cerr << "Shader source error: " << e.what() << std::endl;
+        return 0;
+    }
+}
+
+void setupDefaultProgram() {
+    DefaultUniforms& u = defaultUniforms;
+    GLuint p = shaderProgram;
+    u.uProjection = glGetUniformLocation(p, "uProjection");
+    u.uView = glGetUniformLocation(p, "uView");
+    u.uModel = glGetUniformLocation(p, "uModel");
+    u.viewPos = glGetUniformLocation(p, "viewPos");
+    u.lightPos = glGetUniformLocation(p, "lightPos");
+    u.useTexture = glGetUniformLocation(p, "useTexture");
+    u.disableLighting = glGetUniformLocation(p, "disableLighting");
+    u.uOctNormals = glGetUniformLocation(p, "uOctNormals");
+    u.uColor = glGetUniformLocation(p, "uColor");
+    u.uInstanced = glGetUniformLocation(p, "uInstanced");
+    u.uInstanceOrigin = glGetUniformLocation(p, "uInstanceOrigin");
+    u.uTextureLayer = glGetUniformLocation(p, "uTextureLayer");
+    u.uTextureArray = glGetUniformLocation(p, "uTextureArray");
+    u.uInstanceData = glGetUniformLocation(p, "uInstanceData");
+    // Kazdy typ samplera na osobnej jednostce tekstury
+    glUseProgram(p);
+    glUniform1i(u.uTextureArray, 0);
+    glUniform1i(u.uInstanceData, 1);
+}
+
+void setupImpostorProgram() {
+    ImpostorUniforms& u = impostorUniforms;
+    GLuint p = impostorProgram;
+    u.uProjection = glGetUniformLocation(p, "uProjection");
+    u.uView = glGetUniformLocation(p, "uView");
+    u.uInvProjection = glGetUniformLocation(p, "uInvProjection");
+    u.uViewport = glGetUniformLocation(p, "uViewport");
+    u.uRadius = glGetUniformLocation(p, "uRadius");
+    u.uColor = glGetUniformLocation(p, "uColor");
+    u.uOrigin = glGetUniformLocation(p, "uOrigin");
+}
+
+void setupRibbonProgram() {
+    RibbonUniforms& u = ribbonUniforms;
+    GLuint p = ribbonProgram;
+    u.uProjection = glGetUniformLocation(p, "uProjection");
+    u.uView = glGetUniformLocation(p, "uView");
+    u.uOrigin = glGetUniformLocation(p, "uOrigin");
+    u.uViewportSize = glGetUniformLocation(p, "uViewportSize");
+    u.uWidth = glGetUniformLocation(p, "uWidth");
+    u.uColor = glGetUniformLocation(p, "uColor");
+}
+
+// Przeladowanie shaderow w trakcie dzialania: na Linuksie inotify na katalogu
+// roboczym (edytory czesto zapisuja plik przez rename, wiec obserwujemy katalog,
+// nie plik), gdzie indziej sprawdzanie czasu modyfikacji co pol sekundy.
+// Nieudana kompilacja zostawia poprzedni, dzialajacy program.
+struct WatchedProgram {
+    GLuint* program;
+    const char* vertPath;
+    const char* fragPath;
+    void (*onReload)(); // np. ponowne pobranie polozen uniformow
+    time_t vertTime, fragTime;
+};
+std::vector<WatchedProgram> watchedPrograms;
+bool shaderHotReload = true;
+#ifdef __linux__
+int shaderWatchFd = -1;
+#endif
+double lastShaderPoll = 0.0;
+
+void watchShaderProgram(GLuint* program, const char* vertPath, const char* fragPath, void (*onReload)() = nullptr) {
+    *program = createShaderProgram(vertPath, fragPath);
+    if (*program && onReload) onReload();
+    watchedPrograms.push_back({ program, vertPath, fragPath, onReload, fileModificationTime(vertPath), fileModificationTime(fragPath) });
+#ifdef __linux__
+    if (shaderWatchFd < 0) {
+        shaderWatchFd = inotify_init1(IN_NONBLOCK);
+        if (shaderWatchFd >= 0) inotify_add_watch(shaderWatchFd, ".", IN_CLOSE_WRITE | IN_MOVED_TO);
+    }
+#endif
+}
+
+void reloadShaderProgram(WatchedProgram& w) {
+    w.vertTime = fileModificationTime(w.vertPath);
+    w.fragTime = fileModificationTime(w.fragPath);
+    GLuint program = createShaderProgram(w.vertPath, w.fragPath);
+    if (!program) {
+        std::cerr << "Przeladowanie " << w.vertPath << " / " << w.fragPath << " nieudane - zostaje poprzedni program" << std::endl;
+        return;
+    }
+    if (*w.program) glDeleteProgram(*w.program);
+    *w.program = program;
+    if (w.onReload) w.onReload();
+    std::cout << "Przeladowano " << w.vertPath << " / " << w.fragPath << std::endl;
+}
+
+void pollShaderChanges(double now) {
+    if (!shaderHotReload) return;
+    std::vector<bool> changed(watchedPrograms.size(), false);
+#ifdef __linux__
+    if (shaderWatchFd >= 0) {
+        alignas(inotify_event) char buffer[4096];
+        ssize_t len;
+        while ((len = read(shaderWatchFd, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + len; ptr += sizeof(inotify_event) + ((inotify_event*)ptr)->len) {
+                const inotify_event* ev = (const inotify_event*)ptr;
+                if (ev->len == 0) continue;
+                for (size_t i = 0; i < watchedPrograms.size(); ++i) {
+                    if (std::strcmp(ev->name, watchedPrograms[i].vertPath) == 0 || std::strcmp(ev->name, watchedPrograms[i].fragPath) == 0) changed[i] = true;
+                }
+            }
+        }
+    }
+    else
+#endif
+    {
+        if (now - lastShaderPoll < 0.5) return;
+        lastShaderPoll = now;
+        for (size_t i = 0; i < watchedPrograms.size(); ++i) {
+            const WatchedProgram& w = watchedPrograms[i];
+            changed[i] = fileModificationTime(w.vertPath) != w.vertTime || fileModificationTime(w.fragPath) != w.fragTime;
+        }
+    }
+    for (size_t i = 0; i < watchedPrograms.size(); ++i) {
+        if (changed[i]) reloadShaderProgram(watchedPrograms[i]);
+    }
+}
+
 
 // funkcja do inicjalizacji wszystkich zasobów OpenGL
 void initGL() {
-    shaderProgram = createShaderProgram();
+    initProgramCache();
+    watchShaderProgram(&shaderProgram, "default.vert", "default.frag", setupDefaultProgram);
+    watchShaderProgram(&impostorProgram, "impostor.vert", "impostor.frag", setupImpostorProgram);
+    watchShaderProgram(&ribbonProgram, "ribbon.vert", "ribbon.frag", setupRibbonProgram);
     initSphereVAO();
     initBlockVAO();
+    initTrailPointsVAO();
+    initRibbon();
 
-    // Załadowanie tekstur i zapisanie ich ID w mapie
-    textures["textures/placeholder1.jpg"] = loadTexture("textures/placeholder1.jpg");
-    textures["textures/placeholder2.jpg"] = loadTexture("textures/placeholder2.jpg");
-    textures["textures/placeholder_ground.jpg"] = loadTexture("textures/placeholder_ground.jpg"); // Tekstura dla ziemi
-    textureIDProjectile = loadTexture("textures/placeholder_ball.jpg"); // Tekstura dla pocisku
+    // Rejestracja tekstur w menedzerze i zaladowanie ich do tablic
+    texturePlaceholder1 = textureManager.add("textures/placeholder1.jpg");
+    texturePlaceholder2 = textureManager.add("textures/placeholder2.jpg");
+    textureGround = textureManager.add("textures/placeholder_ground.jpg");
+    textureProjectile = textureManager.add("textures/placeholder_ball.jpg");
+    textureManager.startLoading();
 
-    if (textureIDProjectile == 0) {
+    if (!textureManager.valid(textureProjectile)) {
         std::cerr << "Błąd: Nie załadowano tekstury dla pocisku. Pocisk może być renderowany jako kolor." << std::endl;
     }
 }
 
 
-int main() {
+void printEnergyStats(std::ostream& out) {
+    const EnergyStats& e = energyStats;
+    out << "Czas: " << simTime << " s\n";
+    if (recordEnergy) {
+        out << "Kroki: " << e.steps << "\n"
+            << "Energia poczatkowa: " << e.initialEnergy << " J\n"
+            << "Energia kinetyczna: " << e.kinetic << " J, potencjalna: " << e.potential << " J\n"
+            << "Straty - opor: " << e.lostDrag << " J, hamowanie: " << e.lostDamping
+            << " J, odbicia: " << e.lostRestitution << " J\n"
+            << "Dryf energii - max na krok: " << e.maxStepDrift << " J, suma: " << e.totalDrift << " J\n";
+    }
+    out << "Ped: " << mass * proj.vel.length() << " kg*m/s\n";
+}
+
+// Tryb bez okna: jeden rzut ze stalym krokiem czasowym, wynik na standardowe wyjscie.
+// Uzycie: --headless [--dt 0.004] [--max-time 60] [--stop-first-block] [--stop-bounces N]
+//                   [--rest-energy 0.02] [--rest-window 0.25] [--velocity 50] [--angle 45] [--kahan]
+//                   [--energy] [--wind none|uniform|layered|grid] [--wind-vector 5 0 0]
+//                   [--drag-model simple|g1|g7] [--diameter 0.1] [--air-density]
+//                   [--spin 30] [--sidespin 0]
+int runHeadless(float dt, float maxTime) {
+    initBlocks();
+    reset();
+    applyStopSettings();
+    isRunning = true;
+    CollisionEvent e;
+    while (isRunning && simTime < maxTime) {
+        updateWorldStreaming({ glm::dvec3(proj.pos.x, proj.pos.y, proj.pos.z) });
+        update(dt);
+        while (localCollisionEvents().pop(e)) {
+            std::cout << "Odbicie t=" << e.time << " s, " << describeEventTarget(e)
+                      << ", pozycja " << e.pos.x << " " << e.pos.y << " " << e.pos.z
+                      << ", normalna " << e.normal.x << " " << e.normal.y << " " << e.normal.z
+                      << ", poped " << e.impulse << " N*s\n";
+        }
+    }
+    std::cout << "dt: " << dt << " s\n";
+    std::cout << "Pozycja koncowa: " << proj.pos.x << " " << proj.pos.y << " " << proj.pos.z << "\n";
+    printEnergyStats(std::cout);
+    return 0;
+}
+
+// Krok calkowania sprzed zmian (prosty opor, hamowanie na krok, bez zdarzen i
+// statystyk) - punkt odniesienia dla --benchmark. Kolizje z klockami przez
+// checkCollisionSphereBlock, zeby liczyc na tej samej scenie co pozostale tryby
+bool baselineStep(ProjectileT<float>& p, float dt) {
+    float speed = p.vel.length();
+    float fdrag = drag * speed;
+    Vec3 acc = { -fdrag * p.vel.x / mass, -gravity - fdrag * p.vel.y / mass, -fdrag * p.vel.z / mass };
+    p.vel = p.vel + acc * dt;
+    p.vel = p.vel * dampingFactor;
+    p.pos = p.pos + p.vel * dt;
+
+    float sphereRadius = 0.5f;
+    if (p.pos.y - sphereRadius <= 0.0f && p.vel.y < 0.0f) {
+        p.pos.y = sphereRadius;
+        p.vel.y = -p.vel.y * restitution;
+    }
+    if (p.trail.empty() || std::abs(p.pos.x - p.trail.back().x) > 1.0f || std::abs(p.pos.y - p.trail.back().y) > 1.0f || std::abs(p.pos.z - p.trail.back().z) > 1.0f) {
+        p.trail.push_back(p.pos);
+        if (p.trail.size() > 100) p.trail.pop_front();
+    }
+    for (const Block& block : blocks) {
+        CollisionInfo colInfo = checkCollisionSphereBlock(p.pos, sphereRadius, block);
+        if (colInfo.collided) {
+            p.pos = p.pos + colInfo.normal * (colInfo.penetrationDepth + 0.001f);
+            float velAlongNormal = p.vel.dot(colInfo.normal);
+            if (velAlongNormal < 0) p.vel = p.vel - colInfo.normal * (velAlongNormal * (1.0f + restitution));
+        }
+    }
+    if (p.vel.length() < 0.2f && p.pos.y < 1.0f) {
+        p.vel = { 0,0,0 };
+        return true;
+    }
+    return false;
+}
+
+// Koszt jednego trybu calkowania na biezacych parametrach rzutu
+template <typename T>
+void benchmarkMode(const char* name, bool compensated, float dt, float maxTime, int shots, bool (*step)(ProjectileT<T>&, float)) {
+    bool savedCompensated = compensatedPositions;
+    compensatedPositions = compensated;
+    ProjectileT<T> p;
+    long long steps = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int shot = 0; shot < shots; ++shot) {
+        launchProjectile(p);
+        resetRunStats(p);
+        while (simTime < maxTime) {
+            simTime += dt;
+            ++steps;
+            if (step(p, dt)) break;
+        }
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << seconds * 1e9 / std::max(1LL, steps) << " ns/krok (" << steps << " krokow), "
+              << "pozycja koncowa " << std::setprecision(9) << p.pos.x << " " << p.pos.y << " " << p.pos.z
+              << std::setprecision(6) << "\n";
+    compensatedPositions = savedCompensated;
+}
+
+void benchmarkModes(float dt, float maxTime, int shots) {
+    benchmarkMode<float>("float", false, dt, maxTime, shots, stepProjectile<float>);
+    benchmarkMode<float>("float + Kahan", true, dt, maxTime, shots, stepProjectile<float>);
+    benchmarkMode<double>("double", false, dt, maxTime, shots, stepProjectile<double>);
+    benchmarkMode<double>("double + Kahan", true, dt, maxTime, shots, stepProjectile<double>);
+}
+
+// Porownanie trybow: float / double, z sumowaniem Kahana i bez; najpierw samo
+// calkowanie (bez bilansu energii i zdarzen), potem z nimi - tak jak w oknie.
+// Uzycie: --benchmark [--dt 0.004] [--max-time 60] [--velocity 50] [--angle 45]
+int runBenchmark(float dt, float maxTime) {
+    initBlocks();
+    const int shots = 200;
+    bool savedRecordEnergy = recordEnergy;
+    std::cout << "dt: " << dt << " s, rzutow na tryb: " << shots << "\n";
+    benchmarkMode<float>("przed zmianami (float)", false, dt, maxTime, shots, baselineStep);
+
+    std::cout << "-- samo calkowanie --\n";
+    recordEnergy = false;
+    collisionEventsEnabled = false;
+    benchmarkModes(dt, maxTime, shots);
+
+    std::cout << "-- z bilansem energii i zdarzeniami --\n";
+    recordEnergy = true;
+    collisionEventsEnabled = true;
+    benchmarkModes(dt, maxTime, shots);
+
+    recordEnergy = savedRecordEnergy;
+    return 0;
+}
+
+void printUsage(std::ostream& out) {
+    out << "Uzycie: rzut [opcje]\n"
+        << "  --headless | --benchmark          tryb bez okna / porownanie trybow calkowania\n"
+        << "  --velocity V  --angle A  --dt DT  --max-time T  --kahan  --energy\n"
+        << "  --wind none|uniform|layered|grid  --wind-vector X Y Z\n"
+        << "  --drag-model simple|g1|g7  --diameter D  --air-density  --spin S  --sidespin S\n"
+        << "  --rest-energy E  --rest-window T  --stop-first-block  --stop-bounces N\n"
+        << "  --scene PLIK  --world KATALOG  --world-radius N\n"
+        << "  --compile-scene SCENA WYNIK.rzsc  --compile-world SCENA KATALOG [ROZMIAR]\n";
+}
+
+int main(int argc, char** argv) {
+    bool headless = false, benchmark = false;
+    const char* scenePath = nullptr;
+    const char* worldPath = nullptr;
+    float headlessDt = 1.0f / 240.0f, headlessMaxTime = 60.0f;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--headless") headless = true;
+        else if (arg == "--benchmark") benchmark = true;
+        else if (arg == "--velocity" && i + 1 < argc) velocity = (float)std::atof(argv[++i]);
+        else if (arg == "--angle" && i + 1 < argc) angle = (float)std::atof(argv[++i]);
+        else if (arg == "--kahan") compensatedPositions = true;
+        else if (arg == "--energy") recordEnergy = true;
+        else if (arg == "--wind" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "none") windMode = WIND_NONE;
+            else if (mode == "uniform") windMode = WIND_UNIFORM;
+            else if (mode == "layered") windMode = WIND_LAYERED;
+            else if (mode == "grid") windMode = WIND_GRID;
+            else {
+                std::cerr << "Nieznany model wiatru: " << mode << std::endl;
+                return 1;
+            }
+            if (windMode == WIND_GRID && windGrid.empty()) buildDemoWindGrid();
+        }
+        else if (arg == "--wind-vector" && i + 3 < argc) {
+            windUniform.x = (float)std::atof(argv[++i]);
+            windUniform.y = (float)std::atof(argv[++i]);
+            windUniform.z = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--drag-model" && i + 1 < argc) {
+            std::string model = argv[++i];
+            if (model == "simple") dragModel = DRAG_SIMPLE;
+            else if (model == "g1") dragModel = DRAG_G1;
+            else if (model == "g7") dragModel = DRAG_G7;
+            else {
+                std::cerr << "Nieznany model oporu: " << model << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--diameter" && i + 1 < argc) referenceDiameter = (float)std::atof(argv[++i]);
+        else if (arg == "--air-density") useAirDensityModel = true;
+        else if (arg == "--spin" && i + 1 < argc) {
+            spinEnabled = true;
+            launchBackspin = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--sidespin" && i + 1 < argc) {
+            spinEnabled = true;
+            launchSidespin = (float)std::atof(argv[++i]);
+        }
+        else if (arg == "--dt" && i + 1 < argc) headlessDt = (float)std::atof(argv[++i]);
+        else if (arg == "--max-time" && i + 1 < argc) headlessMaxTime = (float)std::atof(argv[++i]);
+        else if (arg == "--rest-energy" && i + 1 < argc) restEnergyThreshold = (float)std::atof(argv[++i]);
+        else if (arg == "--rest-window" && i + 1 < argc) restTimeWindow = (float)std::atof(argv[++i]);
+        else if (arg == "--stop-first-block") stopOnFirstBlockHit = true;
+        else if (arg == "--stop-bounces" && i + 1 < argc) stopAfterBounces = std::atoi(argv[++i]);
+        else if (arg == "--scene" && i + 1 < argc) scenePath = argv[++i];
+        else if (arg == "--world" && i + 1 < argc) worldPath = argv[++i];
+        else if (arg == "--world-radius" && i + 1 < argc) world.loadRadius = std::max(0, std::atoi(argv[++i]));
+        else if (arg == "--compile-world" && i + 2 < argc) {
+            // --compile-world <scena tekstowa> <katalog> [rozmiar kafelka]
+            float tileSize = i + 3 < argc ? (float)std::atof(argv[i + 3]) : world.tileSize;
+            try {
+                compileWorld(argv[i + 1], argv[i + 2], tileSize > 0.0f ? tileSize : world.tileSize);
+                return 0;
+            }
+            catch (const AssetError& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+        else if (arg == "--compile-scene" && i + 2 < argc) {
+            // --compile-scene <scena tekstowa> <wynik.rzsc>
+            try {
+                SceneSource scene = parseSceneText(argv[i + 1]);
+                writeSceneBinary(argv[i + 2], scene);
+                std::cout << "Zapisano " << scene.blocks.size() << " klockow do " << argv[i + 2] << std::endl;
+                return 0;
+            }
+            catch (const AssetError& e) {
+                std::cerr << e.what() << std::endl;
+                return 1;
+            }
+        }
+        else {
+            // Literowka w nazwie opcji nie moze po cichu zostawic domyslnych parametrow
+            std::cerr << "Nieznana opcja albo brak wartosci: " << arg << "\n";
+            printUsage(std::cerr);
+            return 1;
+        }
+    }
+    if (scenePath) {
+        try {
+            loadScene(scenePath);
+        }
+        catch (const AssetError& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (worldPath && scenePath) {
+        std::cerr << "--world i --scene wykluczaja sie" << std::endl;
+        return 1;
+    }
+    if (worldPath && benchmark) {
+        // --benchmark mierzy samo calkowanie na stalej scenie, bez doczytywania kafelkow
+        std::cerr << "--world nie dziala z --benchmark" << std::endl;
+        return 1;
+    }
+    if (worldPath) {
+        try {
+            // Bez okna kafelki wczytuje watek glowny - wynik nie zalezy od szybkosci dysku
+            openWorld(worldPath, headless);
+            // W trybie swiata klocki sa tylko w kafelkach - bez sceny wbudowanej
+            blocks.assign(std::vector<Block>());
+            sceneFromFile = true;
+        }
+        catch (const AssetError& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (benchmark) return runBenchmark(headlessDt, headlessMaxTime);
+    if (headless) return runHeadless(headlessDt, headlessMaxTime);
+
     glfwInit();
     GLFWwindow* window = glfwCreateWindow(1000, 800, "Rzut ukosny 3D", nullptr, nullptr);
     glfwMakeContextCurrent(window);
@@ -709,7 +3471,8 @@ int main() {
 
     initGL(); //funkcję inicjalizującą GL
 
-    reset(); // Resetuje również klocki
+    initBlocks();
+    reset();
     float lastTime = glfwGetTime();
 
     // Inicjalne ustawienie kursora na środek okna, gdy kamera jest w trybie swobodnym
@@ -744,24 +3507,93 @@ int main() {
         ImGui::SliderFloat("Kat (stopnie)", &angle, 10.0f, 80.0f);
         ImGui::SliderFloat("Kierunek (obrot Y)", &launchYaw, -180.0f, 180.0f);
         ImGui::SliderFloat("Masa pocisku", &mass, 0.1f, 5.0f);
-        ImGui::SliderFloat("Opor powietrza", &drag, 0.0f, 0.05f);
+        ImGui::Combo("Model oporu", &dragModel, "Prosty\0G1 (Cd od Macha)\0G7 (Cd od Macha)\0");
+        if (dragModel == DRAG_SIMPLE) ImGui::SliderFloat("Opor powietrza", &drag, 0.0f, 0.05f);
+        else ImGui::SliderFloat("Srednica pocisku (m)", &referenceDiameter, 0.005f, 0.3f, "%.3f");
         ImGui::SliderFloat("Grawitacja", &gravity, 0.0f, 20.0f);
         ImGui::SliderFloat("Restytucja", &restitution, 0.0f, 1.0f);
         ImGui::SliderFloat("Wspolczynnik Hamowania", &dampingFactor, 0.9f, 0.999f);
+        ImGui::Checkbox("Hamowanie niezalezne od FPS (60 Hz)", &timeContinuousDamping);
+        ImGui::Checkbox("Sumowanie pozycji Kahana", &compensatedPositions);
+        if (ImGui::Combo("Wiatr", &windMode, "Brak\0Staly\0Warstwowy\0Siatka 3D\0")) {
+            if (windMode == WIND_GRID && windGrid.empty()) buildDemoWindGrid();
+        }
+        if (windMode == WIND_UNIFORM) ImGui::SliderFloat3("Wiatr (m/s)", &windUniform.x, -20.0f, 20.0f);
+        ImGui::Checkbox("Rotacja (efekt Magnusa)", &spinEnabled);
+        if (spinEnabled) {
+            ImGui::SliderFloat("Rotacja wsteczna (rad/s)", &launchBackspin, -100.0f, 100.0f);
+            ImGui::SliderFloat("Rotacja boczna (rad/s)", &launchSidespin, -100.0f, 100.0f);
+            ImGui::SliderFloat("Wspolczynnik Magnusa", &magnusCoefficient, 0.0f, 0.01f, "%.4f");
+            ImGui::SliderFloat("Zanik rotacji (1/s)", &spinDecayRate, 0.0f, 2.0f);
+        }
+        ImGui::Checkbox("Gestosc powietrza od wysokosci", &useAirDensityModel);
+        if (useAirDensityModel) ImGui::SliderFloat("Gradient temperatury (K/m)", &temperatureLapseRate, 0.0f, 0.01f, "%.4f");
+
+        ImGui::SliderFloat("Prog spoczynku (J/kg)", &restEnergyThreshold, 0.001f, 0.5f, "%.3f");
+        ImGui::SliderFloat("Czas spoczynku (s)", &restTimeWindow, 0.0f, 2.0f);
+        ImGui::Checkbox("Stop po trafieniu w klocek", &stopOnFirstBlockHit);
+        ImGui::SliderInt("Stop po N odbiciach (0 = wyl.)", &stopAfterBounces, 0, 20);
 
-        if (ImGui::Button("Start")) { reset(); isRunning = true; }
+        if (ImGui::Button("Start")) { reset(); applyStopSettings(); isRunning = true; }
         ImGui::SameLine();
         if (ImGui::Button("Reset")) { reset(); }
-        ImGui::Text("Pozycja pocisku: X=%.1f Y=%.1f Z=%.1f", proj.pos.x, proj.pos.y, proj.pos.z);
+        ImGui::Text("Pozycja pocisku: X=%.1f Y=%.1f Z=%.1f%s", proj.pos.x, proj.pos.y, proj.pos.z, proj.sleeping ? " (spoczynek)" : "");
+        CollisionEvent event;
+        while (localCollisionEvents().pop(event)) {
+            recentEvents.push_back(event);
+            if (recentEvents.size() > 8) recentEvents.pop_front();
+        }
+        ImGui::Combo("Slad", &trailStyle, "Kule\0Impostory\0Wstega\0");
+        if (trailStyle == TRAIL_RIBBON) ImGui::SliderFloat("Szerokosc wstegi", &ribbonWidth, 1.0f, 20.0f);
+        if (ImGui::SliderInt("Dlugosc sladu", &maxTrailPoints, 10, 100000, "%d", ImGuiSliderFlags_Logarithmic)) {
+            // Przyciecie od razu - takze gdy pocisk juz lezy i slad nie rosnie
+            while (proj.trail.size() > (size_t)maxTrailPoints) proj.trail.pop_front();
+        }
+        ImGui::Checkbox("Odrzucanie poza kamera", &frustumCulling);
+        ImGui::SameLine();
+        ImGui::Text("pominiete: %d", culledDraws);
+        ImGui::Text("Klocki: %d widocznych, %d wywolan rysowania", visibleBlockCount, blockDrawCalls);
+        if (world.enabled) {
+            ImGui::Text("Swiat: %d kafelkow (%d klockow), w kolejce %d", (int)world.resident.size(), (int)worldResidentBlocks(), (int)world.pending.size());
+            ImGui::SliderInt("Promien wczytywania", &world.loadRadius, 0, 4);
+        }
+        if (textureManager.pendingCount > 0) {
+            ImGui::Text("Ladowanie tekstur: zostalo %d", textureManager.pendingCount);
+        }
+        ImGui::SliderInt("Wysylanie tekstur [MB/klatke]", &textureUploadBudgetMB, 1, 64);
+        ImGui::Checkbox("Przeladowanie shaderow", &shaderHotReload);
+        if (ImGui::CollapsingHeader("Odbicia")) {
+            ImGui::Text("Odbicia: %d, trafienia w klocki: %d", runCounters.bounces, runCounters.blockHits);
+            for (auto& e : recentEvents) {
+                ImGui::Text("t=%.2f s  %s  poped %.2f N*s", e.time, describeEventTarget(e).c_str(), e.impulse);
+            }
+        }
+        if (ImGui::CollapsingHeader("Bilans energii")) {
+            const EnergyStats& e = energyStats;
+            ImGui::Checkbox("Zbieraj statystyki", &recordEnergy);
+            ImGui::Text("Poczatkowa: %.2f J  Aktualna: %.2f J", e.initialEnergy, e.kinetic + e.potential);
+            ImGui::Text("Kinetyczna: %.2f J  Potencjalna: %.2f J", e.kinetic, e.potential);
+            ImGui::Text("Straty: opor %.2f J, hamowanie %.2f J, odbicia %.2f J", e.lostDrag, e.lostDamping, e.lostRestitution);
+            ImGui::Text("Dryf: max/krok %.4f J, suma %.3f J", e.maxStepDrift, e.totalDrift);
+            ImGui::Text("Ped: %.2f kg*m/s", mass * proj.vel.length());
+        }
         ImGui::End();
 
         ImGui::Render();
+        int framebufferWidth;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        // Dokladamy kolejna porcje tekstur; gotowa warstwa zmienia dane instancji klockow
+        if (textureManager.pump((size_t)textureUploadBudgetMB << 20)) blockInstanceDataDirty = true;
+        pollShaderChanges(glfwGetTime());
+        updateWorldStreaming({ cameraPos, glm::dvec3(proj.pos.x, proj.pos.y, proj.pos.z) });
         renderScene();
         ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
         glfwSwapBuffers(window);
     }
 
+    closeWorld();
+    textureManager.shutdown();
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -0,0 +1,9 @@
+// ribbon.frag
+#version 330 core
+out vec4 FragColor; // koncowy kolor piksela
+
+uniform vec4 uColor; // kolor sladu (bez oswietlenia, jak dotychczas)
+
+void main() {
+    FragColor = uColor;
+}
@@ -0,0 +1,27 @@
+// ribbon.vert
+#version 330 core
+layout(location = 0) in vec3 aPos;   // koniec odcinka (wzgledem uOrigin)
+layout(location = 1) in vec3 aOther; // drugi koniec odcinka (wzgledem uOrigin)
+layout(location = 2) in float aSide; // strona wstegi: +1 albo -1
+
+uniform mat4 uProjection;   // macierz rzutowania
+uniform mat4 uView;         // macierz widoku kamery
+uniform vec3 uOrigin;       // poczatek ukladu wstegi wzgledem kamery
+uniform vec2 uViewportSize; // rozmiar obszaru rysowania w pikselach
+uniform float uWidth;       // szerokosc wstegi w pikselach
+
+void main() {
+    vec4 clipPos = uProjection * uView * vec4(aPos + uOrigin, 1.0);
+    vec4 clipOther = uProjection * uView * vec4(aOther + uOrigin, 1.0);
+
+    // kierunek odcinka w pikselach; w ograniczone od dolu dla punktow za kamera
+    vec2 screenPos = clipPos.xy / max(clipPos.w, 1e-4) * uViewportSize;
+    vec2 screenOther = clipOther.xy / max(clipOther.w, 1e-4) * uViewportSize;
+    vec2 dir = screenOther - screenPos;
+    dir = length(dir) > 1e-6 ? normalize(dir) : vec2(1.0, 0.0);
+    vec2 normal = vec2(-dir.y, dir.x);
+
+    // przesuniecie o pol szerokosci w pikselach, przeliczone z powrotem do clip space
+    vec2 offset = normal * aSide * uWidth / uViewportSize;
+    gl_Position = clipPos + vec4(offset * clipPos.w, 0.0, 0.0);
+}